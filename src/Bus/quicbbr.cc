@@ -36,6 +36,24 @@
 #include "ns3/applications-module.h"
 #include "ns3/packet-sink.h"
 #include "ns3/quic-bbr.h"
+#include "../common/steady-state-monitor.h"
+#include "../common/replication.h"
+#include "../common/snapshot-fork.h"
+#include "../common/link-events.h"
+#include "../common/link-monitor.h"
+#include "../common/metric-store.h"
+#include "../common/flow-aggregator.h"
+#include "../common/callback-profiler.h"
+#include "../common/scheduler-bench.h"
+#include "../common/flow-sink.h"
+#include "../common/rate-estimator.h"
+#include "../common/bbr-tracer.h"
+#include "../common/loss-recovery.h"
+#include "../common/hop-latency.h"
+#include "../common/churn-workload.h"
+#include "../common/node-roles.h"
+#include "../common/bulk-sender.h"
+#include "../common/route-cache.h"
 
 using namespace ns3;
 
@@ -50,6 +68,54 @@ double g_rtt = 0;
 uint32_t packetsSent = 0;
 uint32_t packetsReceived = 0; // Tracked based on received bytes
 
+// Optional early termination once throughput and RTT settle
+SteadyStateMonitor g_steadyState;
+
+// Multi-seed replication driver (--replications)
+ReplicationRunner g_replication;
+
+// Fork-based branching after the warm-up period (--snapshotTime)
+SnapshotBrancher g_snapshot;
+
+// Scheduled link rate/delay changes and failures (--linkEvents)
+LinkEventTimeline g_linkEvents;
+
+// Per-link utilization and queue sampling (--linkStatsPeriod)
+LinkMonitor g_linkMonitor;
+
+// Every sampled metric goes through here (replication, --outputFormat=columnar)
+MetricStore g_metrics(g_replication);
+
+// Per-flow counters at the server (--flowStatsPeriod)
+FlowAggregator g_flowStats;
+
+// Per-callback call counts and time (--profile)
+CallbackProfiler &g_profiler = CallbackProfiler::Instance();
+
+// Event scheduler choice and --schedulerBenchmark runs
+SchedulerBenchmark g_schedulers(g_replication);
+
+// Goodput and wire throughput per sampling interval (--throughputMode)
+RateEstimator g_rate;
+
+// BBR controller state per flow (--bbrTracePeriod)
+BbrTracer &g_bbr = BbrTracer::Instance();
+
+// Lost packets, PTOs and spurious PTOs per flow (--recoveryStats)
+LossRecoveryStats &g_recovery = LossRecoveryStats::Instance();
+
+// Queue, serialization and propagation time per hop (--hopLatency)
+HopLatencyMonitor g_hopLatency;
+
+// Short connections measuring handshake and time to first byte (--churnRate)
+ChurnWorkload g_churn;
+
+// Endpoint and router stacks, stack memory per node (<prefix>.nodemem)
+NodeRoles g_nodeRoles;
+
+// Global routes computed once per topology and reused (--routeCache)
+RouteCache g_routeCache;
+
 // Trace callback functions to update the global variables
 void CwndTracer(uint32_t oldCwnd, uint32_t newCwnd) {
     g_cwnd = newCwnd / PACKET_SIZE;  // Convert to packets
@@ -68,7 +134,7 @@ void PacketSentCallback(Ptr<const Packet> packet) {
 }
 
 // Function to calculate and log packet loss
-void CalculatePacketLoss(std::ofstream &packetLossFile, Ptr<PacketSink> sink) {
+void CalculatePacketLoss(std::ofstream &packetLossFile, Ptr<FlowSink> sink) {
     double time = Simulator::Now().GetSeconds();
 
     // Get the total number of packets received by converting bytes to packets
@@ -79,55 +145,59 @@ void CalculatePacketLoss(std::ofstream &packetLossFile, Ptr<PacketSink> sink) {
     if (packetsSent > 0) {
         double packetLoss = ((packetsSent - packetsReceived) / static_cast<double>(packetsSent)) * 100;
         packetLossFile << time << "\t" << packetLoss << std::endl;
+        g_metrics.Record(METRIC_PACKETLOSS, time, packetLoss);
         NS_LOG_INFO("Packet Loss at " << time << " seconds: " << packetLoss << "%");
     } else {
         packetLossFile << time << "\t" << 0.0 << std::endl;
+        g_metrics.Record(METRIC_PACKETLOSS, time, 0.0);
     }
 
     // Schedule packet loss calculation every second
-    Simulator::Schedule(Seconds(1.0), &CalculatePacketLoss, std::ref(packetLossFile), sink);
+    Simulator::Schedule(Seconds(1.0), PROFILED(CalculatePacketLoss), std::ref(packetLossFile), sink);
 }
 
 // Function to trace metrics
-void TraceMetrics(Ptr<PacketSink> sink, std::ofstream &throughputFile, std::ofstream &rttFile, std::ofstream &cwndFile) {
-    static uint64_t lastTotalRx = 0;
-
+void TraceMetrics(Ptr<FlowSink> sink, std::ofstream &throughputFile, std::ofstream &rttFile, std::ofstream &cwndFile) {
     double timeInSeconds = Simulator::Now().GetSeconds();
 
-    // Calculate throughput in Mbps
-    uint64_t totalRx = sink->GetTotalRx();
-    double throughput = ((totalRx - lastTotalRx) * 8.0) / 1e6; // Mbps
-    lastTotalRx = totalRx;
+    // Goodput and wire throughput in Mbps over the time since the last call
+    g_rate.Sample(sink->GetTotalRx());
+    double throughput = g_rate.GetGoodput();
 
     // Write metrics to files
-    throughputFile << timeInSeconds << "\t" << throughput << std::endl;
+    throughputFile << timeInSeconds << "\t" << throughput << "\t" << g_rate.GetWireThroughput() << std::endl;
+    g_metrics.Record(METRIC_THROUGHPUT, timeInSeconds, throughput);
+    g_metrics.RecordFlowThroughput(timeInSeconds, sink->GetFlows());
     rttFile << timeInSeconds << "\t" << (g_rtt * 1000) << std::endl; // RTT in milliseconds
+    g_metrics.Record(METRIC_RTT, timeInSeconds, g_rtt * 1000);
     cwndFile << timeInSeconds << "\t" << g_cwnd << std::endl;
+    g_metrics.Record(METRIC_CWND, timeInSeconds, g_cwnd);
+    g_steadyState.AddSample(throughput, g_rtt * 1000);
+    g_linkEvents.AddThroughputSample(throughput);
 
     // Schedule next call to TraceMetrics
-    Simulator::Schedule(Seconds(1.0), &TraceMetrics, sink, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
+    Simulator::Schedule(Seconds(1.0), PROFILED(TraceMetrics), sink, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
 }
 
 void AttachTraces(Ptr<Application> app) {
-    Ptr<BulkSendApplication> bulkSendApp = DynamicCast<BulkSendApplication>(app);
-    if (bulkSendApp) {
-        Ptr<Socket> socket = bulkSendApp->GetSocket();
+    if (BulkSenderHelper::IsSender(app)) {
+        Ptr<Socket> socket = BulkSenderHelper::GetSocket(app);
         if (socket) {
             Ptr<QuicSocketBase> quicSocket = DynamicCast<QuicSocketBase>(socket);
             if (quicSocket) {
-                quicSocket->TraceConnectWithoutContext("CongestionWindow", MakeCallback(&CwndTracer));
-                quicSocket->TraceConnectWithoutContext("RTT", MakeCallback(&RttTracer));
+                quicSocket->TraceConnectWithoutContext("CongestionWindow", MakeCallback(PROFILED(CwndTracer)));
+                quicSocket->TraceConnectWithoutContext("RTT", MakeCallback(PROFILED(RttTracer)));
                 NS_LOG_INFO("Traces successfully attached for cwnd and RTT.");
             } else {
                 NS_LOG_INFO("Socket not available yet, retrying...");
-                Simulator::Schedule(Seconds(0.1), &AttachTraces, app);
+                Simulator::Schedule(Seconds(0.1), PROFILED(AttachTraces), app);
             }
         } else {
             NS_LOG_INFO("Socket is null, retrying...");
-            Simulator::Schedule(Seconds(0.1), &AttachTraces, app);
+            Simulator::Schedule(Seconds(0.1), PROFILED(AttachTraces), app);
         }
     } else {
-        NS_LOG_ERROR("Failed to get BulkSendApplication.");
+        NS_LOG_ERROR("Failed to get the bulk sender application.");
     }
 }
 
@@ -150,6 +220,36 @@ int main(int argc, char *argv[]) {
     uint32_t maxPackets = 0;
     uint32_t NUM_NODES = 6; // Total number of nodes in the bus topology
     double DURATION = 100.0; // Set duration to 100 seconds
+    bool steadyState = false;
+    double steadyWindow = 10.0;
+    double steadyTolerance = 0.05;
+    double steadyMinTime = 10.0;
+    uint32_t replications = 1;
+    double ciBinWidth = 1.0;
+    double snapshotTime = 0.0;
+    std::string snapshotBranches = "";
+    std::string linkEvents = "";
+    double recoveryWindow = 5.0;
+    double recoveryTolerance = 0.1;
+    double linkStatsPeriod = 0.0;
+    std::string linkStatsFormat = "columnar";
+    std::string outputFormat = "text";
+    double flowStatsPeriod = 0.0;
+    int32_t flowStatsNode = -1;
+    bool profile = false;
+    std::string scheduler = "map";
+    std::string schedulerBenchmark = "";
+    std::string throughputMode = "window";
+    double bbrTracePeriod = 0.0;
+    bool recoveryStats = false;
+    bool hopLatency = false;
+    double churnRate = 0.0;
+    uint32_t churnRequest = 100;
+    uint32_t churnResponse = 1000;
+    bool churnZeroRtt = false;
+    std::string sender = "virtual";
+    bool senderBenchmark = false;
+    std::string routeCache = "";
 
     Time::SetResolution(Time::NS);
     CommandLine cmd;
@@ -159,40 +259,139 @@ int main(int argc, char *argv[]) {
     cmd.AddValue("QUICFlows", "Number of application flows between sender and receiver", QUICFlows);
     cmd.AddValue("Pacing", "Flag to enable/disable pacing in QUIC", isPacingEnabled);
     cmd.AddValue("PacingRate", "Max Pacing Rate in bps", pacingRate);
+    cmd.AddValue("steadyState", "Stop the run once throughput and RTT are stable", steadyState);
+    cmd.AddValue("steadyWindow", "Steady-state detection window in seconds", steadyWindow);
+    cmd.AddValue("steadyTolerance", "Maximum coefficient of variation considered stable", steadyTolerance);
+    cmd.AddValue("steadyMinTime", "Earliest time in seconds at which the run may stop", steadyMinTime);
+    cmd.AddValue("replications", "Number of independent replications (RngRun, RngRun+1, ...)", replications);
+    cmd.AddValue("ciBinWidth", "Time bin in seconds for the replication confidence intervals", ciBinWidth);
+    cmd.AddValue("snapshotTime", "Warm-up time in seconds after which the run forks into branches", snapshotTime);
+    cmd.AddValue("snapshotBranches", "Per-branch Config paths to change, e.g. \"path=value,...;path=value\"", snapshotBranches);
+    cmd.AddValue("linkEvents", "Link event timeline, e.g. \"10s:rate:1:2Mbps;30s:down:0;40s:up:0\"", linkEvents);
+    cmd.AddValue("recoveryWindow", "Window in seconds used to detect throughput re-convergence", recoveryWindow);
+    cmd.AddValue("recoveryTolerance", "Coefficient of variation at which throughput counts as re-converged", recoveryTolerance);
+    cmd.AddValue("linkStatsPeriod", "Per-link utilization/queue sampling period in seconds (0 = off)", linkStatsPeriod);
+    cmd.AddValue("linkStatsFormat", "Link statistics file format: columnar or text", linkStatsFormat);
+    cmd.AddValue("outputFormat", "Metric output format: text (one file per metric) or columnar (one .ncol file)", outputFormat);
+    cmd.AddValue("flowStatsPeriod", "Per-flow summary export period in seconds (0 = off)", flowStatsPeriod);
+    cmd.AddValue("flowStatsNode", "Node whose received flows are aggregated (-1 = the server)", flowStatsNode);
+    cmd.AddValue("profile", "Time every scenario callback and write quicbbr.profile", profile);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar or priorityqueue", scheduler);
+    cmd.AddValue("schedulerBenchmark", "Run once per scheduler (\"all\" or e.g. \"map,heap\") and report events/s", schedulerBenchmark);
+    cmd.AddValue("throughputMode", "Throughput estimate: window (per sampling interval) or ewma:<seconds>", throughputMode);
+    cmd.AddValue("bbrTracePeriod", "BBR state sampling period in seconds (0 = off)", bbrTracePeriod);
+    cmd.AddValue("recoveryStats", "Write lost-packet and PTO events and totals per flow", recoveryStats);
+    cmd.AddValue("hopLatency", "Per-hop delay histograms and one-way delay per node pair (quicbbr.hops)", hopLatency);
+    cmd.AddValue("churnRate", "Short connections per second from every client (0 = off)", churnRate);
+    cmd.AddValue("churnRequest", "Request size in bytes of a short connection", churnRequest);
+    cmd.AddValue("churnResponse", "Response size in bytes of a short connection", churnResponse);
+    cmd.AddValue("churnZeroRtt", "Send the short-connection request with the first QUIC flight (0-RTT)", churnZeroRtt);
+    cmd.AddValue("sender", "Bulk sender: virtual (shared payload, batched writes) or bulk (BulkSendApplication)", sender);
+    cmd.AddValue("senderBenchmark", "Run once with each bulk sender and report events/s and peak RSS", senderBenchmark);
+    cmd.AddValue("routeCache", "Directory of global routes cached per topology (empty = compute every run)", routeCache);
     cmd.Parse(argc, argv);
 
+    if (steadyState) {
+        g_steadyState.Enable(steadyWindow, steadyTolerance, steadyMinTime);
+    }
+
+    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/"; //CHANGE THIS
+
+    if (snapshotTime > 0 && replications > 1) {
+        std::cerr << "--snapshotTime cannot be combined with --replications" << std::endl;
+        return 1;
+    }
+
+    if ((!schedulerBenchmark.empty() || senderBenchmark) && (replications > 1 || snapshotTime > 0)) {
+        std::cerr << "--schedulerBenchmark and --senderBenchmark cannot be combined with --replications or --snapshotTime"
+                  << std::endl;
+        return 1;
+    }
+
+    if (!schedulerBenchmark.empty() && senderBenchmark) {
+        std::cerr << "--schedulerBenchmark cannot be combined with --senderBenchmark" << std::endl;
+        return 1;
+    }
+
+    // Each replication runs in a child process; the parent only aggregates their samples
+    if (replications > 1 && g_replication.Fork(replications, ciBinWidth) < 0) {
+        EnsureDirectoryExists(outputDir);
+        g_replication.WriteConfidenceIntervals(outputDir + "quicbbr");
+        return 0;
+    }
+
+    // Same scenario once per scheduler, each in a child process; the parent only reports events/s
+    if (!schedulerBenchmark.empty() &&
+        g_schedulers.Fork(schedulerBenchmark, scheduler, outputDir + "quicbbr.schedulers") < 0) {
+        return 0;
+    }
+
+    // Same scenario once per bulk sender, each in a child process; the parent reports events/s and RSS
+    if (senderBenchmark &&
+        g_schedulers.ForkEach("sender", {"bulk", "virtual"}, sender, outputDir + "quicbbr.senders") < 0) {
+        return 0;
+    }
+    if (!BulkSenderHelper::Use(sender)) {
+        return 1;
+    }
+    g_routeCache.Configure(routeCache);
+    if (!SchedulerBenchmark::Apply(scheduler)) {
+        return 1;
+    }
+    if (!g_rate.Configure(throughputMode)) {
+        return 1;
+    }
+    if (bbrTracePeriod > 0) {
+        g_bbr.Configure(Seconds(bbrTracePeriod), g_metrics);
+    }
+    if (recoveryStats) {
+        g_recovery.Configure(g_metrics);
+    }
+
     Config::SetDefault("ns3::TcpSocketState::MaxPacingRate", StringValue(pacingRate));
     Config::SetDefault("ns3::TcpSocketState::EnablePacing", BooleanValue(isPacingEnabled));
 
     NodeContainer nodes;
     nodes.Create(NUM_NODES); // Create 6 nodes for the bus topology
 
-    InternetStackHelper stack;
-    stack.Install(nodes);
+    // Every node on the bus is a host
+    g_nodeRoles.Install(nodes, nodes);
 
+    // QUIC on the endpoints only
     QuicHelper quic;
-    quic.InstallQuic(nodes);
+    g_nodeRoles.InstallEndpoints([&quic](NodeContainer node) { quic.InstallQuic(node); });
 
     Config::SetDefault("ns3::QuicL4Protocol::SocketType", StringValue("ns3::QuicBbr"));
+    if (g_bbr.IsEnabled() || g_recovery.IsEnabled()) {
+        // Same controller, registered with the BBR tracer and the loss-recovery statistics
+        Config::SetDefault("ns3::QuicL4Protocol::SocketType", StringValue(TracedQuicBbr::GetTypeId().GetName()));
+    }
 
     CsmaHelper csma;
     csma.SetChannelAttribute("DataRate", StringValue("85Mbps"));
     csma.SetChannelAttribute("Delay", StringValue("3ms"));
 
     NetDeviceContainer devices = csma.Install(nodes);
+    g_linkEvents.AddLink(devices); // link 0: the shared bus
+    g_linkMonitor.AddLink(devices);
 
     Ipv4AddressHelper address;
     address.SetBase("10.1.1.0", "255.255.255.0");
     Ipv4InterfaceContainer interfaces = address.Assign(devices);
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    g_routeCache.Populate("quicbbr-Bus-" + std::to_string(nodes.GetN()));
+
+    if (!linkEvents.empty()) {
+        g_linkEvents.SetRecoveryCriterion(recoveryWindow, recoveryTolerance);
+        g_linkEvents.Schedule(linkEvents);
+    }
 
     ApplicationContainer sourceApps;
     ApplicationContainer sinkApps;
 
     uint16_t port = 10000;
 
-    PacketSinkHelper sinkHelper("ns3::QuicSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
+    FlowSinkHelper sinkHelper("ns3::QuicSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
     ApplicationContainer sinkApp = sinkHelper.Install(nodes.Get(NUM_NODES - 1)); // Server
     sinkApp.Start(Seconds(0.0));
     sinkApp.Stop(Seconds(DURATION));
@@ -201,30 +400,120 @@ int main(int argc, char *argv[]) {
     Ipv4Address serverAddress = interfaces.GetAddress(NUM_NODES - 1);
 
     for (uint32_t i = 0; i < NUM_NODES - 1; ++i) {
-        BulkSendHelper source("ns3::QuicSocketFactory", InetSocketAddress(serverAddress, port));
+        BulkSenderHelper source("ns3::QuicSocketFactory", InetSocketAddress(serverAddress, port));
         source.SetAttribute("MaxBytes", UintegerValue(maxBytes));
         ApplicationContainer clientApp = source.Install(nodes.Get(i));
         sourceApps.Add(clientApp);
-        Simulator::Schedule(Seconds(0.1), &AttachTraces, clientApp.Get(0));
-        clientApp.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+        Simulator::Schedule(Seconds(0.1), PROFILED(AttachTraces), clientApp.Get(0));
+        clientApp.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(PROFILED(PacketSentCallback)));
+    }
+
+    // Short request/response connections to the server next to the bulk flow (--churnRate)
+    if (churnRate > 0) {
+        if (churnZeroRtt && !ChurnWorkload::EnableZeroRtt()) {
+            return 1;
+        }
+        g_churn.Configure("ns3::QuicSocketFactory", churnRate, churnRequest, churnResponse, churnZeroRtt,
+                          g_metrics);
+        ApplicationContainer churnServer = g_churn.InstallServer(nodes.Get(NUM_NODES - 1));
+        churnServer.Start(Seconds(0.0));
+        churnServer.Stop(Seconds(DURATION));
+        ApplicationContainer churnClients;
+        for (uint32_t i = 0; i < NUM_NODES - 1; ++i) {
+            churnClients.Add(g_churn.InstallClient(nodes.Get(i), serverAddress));
+        }
+        churnClients.Start(Seconds(1.0));
+        churnClients.Stop(Seconds(DURATION));
     }
 
-    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/"; //CHANGE THIS 
     EnsureDirectoryExists(outputDir);
 
-    std::ofstream throughputFile(outputDir + "quicbbr.throughput");
-    std::ofstream rttFile(outputDir + "quicbbr.rtt");
-    std::ofstream cwndFile(outputDir + "quicbbr.cwnd");
-    std::ofstream packetLossFile(outputDir + "quicbbr.packetloss");
+    // --outputFormat=columnar replaces the four text series with one <prefix>.ncol file
+    if (outputFormat == "columnar") {
+        g_metrics.Open(g_replication.OutputPath(outputDir + "quicbbr.ncol"), "quicbbr", "Bus", DURATION, argc, argv);
+    }
+
+    std::ofstream throughputFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.throughput")));
+    std::ofstream rttFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.rtt")));
+    std::ofstream cwndFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.cwnd")));
+    std::ofstream packetLossFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.packetloss")));
 
     if (!throughputFile.is_open() || !rttFile.is_open() || !cwndFile.is_open() || !packetLossFile.is_open()) {
         NS_LOG_ERROR("Could not open output files for writing");
         return 1;
     }
 
-    Ptr<PacketSink> sinkPtr = DynamicCast<PacketSink>(sinkApp.Get(0));
-    Simulator::Schedule(Seconds(1.0), &TraceMetrics, sinkPtr, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
-    Simulator::Schedule(Seconds(1.0), &CalculatePacketLoss, std::ref(packetLossFile), sinkPtr);
+    // One columnar file for all link telemetry unless --linkStatsFormat=text
+    std::string linkStatsFile = outputDir + "quicbbr.links" + (linkStatsFormat == "text" ? "" : ".ncol");
+    if (linkStatsPeriod > 0) {
+        g_linkMonitor.Start(Seconds(linkStatsPeriod), g_replication.OutputPath(linkStatsFile), linkStatsFormat != "text");
+    }
+
+    // IPFIX-like flow records of the packets reaching one node
+    std::string flowStatsFile = outputDir + "quicbbr.flows";
+    if (flowStatsPeriod > 0) {
+        if (flowStatsNode >= static_cast<int32_t>(NodeList::GetNNodes())) {
+            std::cerr << "--flowStatsNode must be below " << NodeList::GetNNodes() << std::endl;
+            return 1;
+        }
+        Ptr<Node> flowNode = flowStatsNode >= 0 ? NodeList::GetNode(flowStatsNode) : nodes.Get(NUM_NODES - 1);
+        g_flowStats.Start(flowNode, Seconds(flowStatsPeriod), g_replication.OutputPath(flowStatsFile));
+    }
+
+    // BtlBw, RTprop, gains and state of every BBR controller
+    std::string bbrFile = g_metrics.TextPath(outputDir + "quicbbr.bbr");
+    if (g_bbr.IsEnabled()) {
+        g_bbr.Start(g_replication.OutputPath(bbrFile));
+    }
+
+    // Lost packets and PTOs of every flow
+    std::string recoveryFile = g_metrics.TextPath(outputDir + "quicbbr.recovery");
+    if (g_recovery.IsEnabled()) {
+        g_recovery.Start(g_replication.OutputPath(recoveryFile));
+    }
+
+    // Per-hop delay decomposition and one-way delays, read by tags on the packets
+    if (hopLatency) {
+        g_hopLatency.Install();
+    }
+
+    // Handshake, time to first byte and completion of every short connection
+    std::string churnFile = g_metrics.TextPath(outputDir + "quicbbr.churn");
+    if (g_churn.IsEnabled()) {
+        g_churn.Start(g_replication.OutputPath(churnFile));
+    }
+
+    // Every snapshot branch continues these series in its own files
+    g_snapshot.AddOutput(throughputFile, g_metrics.TextPath(outputDir + "quicbbr.throughput"));
+    g_snapshot.AddOutput(rttFile, g_metrics.TextPath(outputDir + "quicbbr.rtt"));
+    g_snapshot.AddOutput(cwndFile, g_metrics.TextPath(outputDir + "quicbbr.cwnd"));
+    g_snapshot.AddOutput(packetLossFile, g_metrics.TextPath(outputDir + "quicbbr.packetloss"));
+    if (linkStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_linkMonitor.GetSeriesStream(), linkStatsFile);
+    }
+    if (flowStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_flowStats.GetStream(), flowStatsFile);
+    }
+    if (g_bbr.IsEnabled()) {
+        g_snapshot.AddOutput(g_bbr.GetStream(), bbrFile);
+    }
+    if (g_recovery.IsEnabled()) {
+        g_snapshot.AddOutput(g_recovery.GetStream(), recoveryFile);
+    }
+    if (g_churn.IsEnabled()) {
+        g_snapshot.AddOutput(g_churn.GetStream(), churnFile);
+    }
+    if (g_metrics.IsEnabled()) {
+        g_snapshot.AddOutput(g_metrics.GetStream(), outputDir + "quicbbr.ncol");
+    }
+    if (snapshotTime > 0) {
+        g_snapshot.Schedule(Seconds(snapshotTime), snapshotBranches);
+    }
+
+    Ptr<FlowSink> sinkPtr = DynamicCast<FlowSink>(sinkApp.Get(0));
+    g_rate.WatchNode(sinkPtr->GetNode());
+    Simulator::Schedule(Seconds(1.0), PROFILED(TraceMetrics), sinkPtr, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
+    Simulator::Schedule(Seconds(1.0), PROFILED(CalculatePacketLoss), std::ref(packetLossFile), sinkPtr);
 
     sinkApps.Start(Seconds(0.0));
     sinkApps.Stop(Seconds(DURATION));
@@ -232,12 +521,34 @@ int main(int argc, char *argv[]) {
     sourceApps.Stop(Seconds(DURATION - 1.0));
 
     Simulator::Stop(Seconds(DURATION));
-    Simulator::Run();
+    if (profile) {
+        g_profiler.Start();
+    }
+    g_schedulers.Run();
+    g_profiler.Stop();
+
+    g_steadyState.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.steadystate")));
+    g_linkEvents.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.linkevents")));
+    g_linkMonitor.WriteHotspotReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.hotspots")));
+    g_profiler.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.profile")));
+    g_bbr.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.bbrstates")));
+    g_recovery.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.recoverystats")));
+    g_hopLatency.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.hops")));
+    g_hopLatency.WriteHistograms(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.hophist")));
+    g_churn.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.churnstats")));
+    g_nodeRoles.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.nodemem")));
+    g_snapshot.WaitForBranches();
 
     throughputFile.close();
     rttFile.close();
     cwndFile.close();
     packetLossFile.close();
+    g_linkMonitor.Close();
+    g_metrics.Close();
+    g_flowStats.Close();
+    g_bbr.Close();
+    g_recovery.Close();
+    g_churn.Close();
 
     Simulator::Destroy();
     NS_LOG_INFO("Done.");
@@ -35,6 +35,27 @@
 #include "ns3/network-module.h"
 #include "ns3/packet-sink.h"
 #include "ns3/quic-bbr.h"
+#include "../common/steady-state-monitor.h"
+#include "../common/replication.h"
+#include "../common/snapshot-fork.h"
+#include "../common/link-events.h"
+// ns-3.41 passes the routing callbacks by const reference (ecmp-routing.h)
+#define NS3_CONST_REF_CALLBACKS 1
+#include "../common/ecmp-routing.h"
+#include "../common/link-monitor.h"
+#include "../common/metric-store.h"
+#include "../common/flow-aggregator.h"
+#include "../common/callback-profiler.h"
+#include "../common/scheduler-bench.h"
+#include "../common/flow-sink.h"
+#include "../common/rate-estimator.h"
+#include "../common/bbr-tracer.h"
+#include "../common/loss-recovery.h"
+#include "../common/hop-latency.h"
+#include "../common/churn-workload.h"
+#include "../common/node-roles.h"
+#include "../common/bulk-sender.h"
+#include "../common/route-cache.h"
 #include <iomanip>
 
 using namespace ns3;
@@ -48,6 +69,54 @@ double g_rtt = 0;
 uint32_t packetsSent = 0;
 uint32_t packetsReceived = 0;
 
+// Optional early termination once throughput and RTT settle
+SteadyStateMonitor g_steadyState;
+
+// Multi-seed replication driver (--replications)
+ReplicationRunner g_replication;
+
+// Fork-based branching after the warm-up period (--snapshotTime)
+SnapshotBrancher g_snapshot;
+
+// Scheduled link rate/delay changes and failures (--linkEvents)
+LinkEventTimeline g_linkEvents;
+
+// Per-link utilization and queue sampling (--linkStatsPeriod)
+LinkMonitor g_linkMonitor;
+
+// Every sampled metric goes through here (replication, --outputFormat=columnar)
+MetricStore g_metrics(g_replication);
+
+// Per-flow counters at the server (--flowStatsPeriod)
+FlowAggregator g_flowStats;
+
+// Per-callback call counts and time (--profile)
+CallbackProfiler &g_profiler = CallbackProfiler::Instance();
+
+// Event scheduler choice and --schedulerBenchmark runs
+SchedulerBenchmark g_schedulers(g_replication);
+
+// Goodput and wire throughput per sampling interval (--throughputMode)
+RateEstimator g_rate;
+
+// BBR controller state per flow (--bbrTracePeriod)
+BbrTracer &g_bbr = BbrTracer::Instance();
+
+// Lost packets, PTOs and spurious PTOs per flow (--recoveryStats)
+LossRecoveryStats &g_recovery = LossRecoveryStats::Instance();
+
+// Queue, serialization and propagation time per hop (--hopLatency)
+HopLatencyMonitor g_hopLatency;
+
+// Short connections measuring handshake and time to first byte (--churnRate)
+ChurnWorkload g_churn;
+
+// Endpoint and router stacks, stack memory per node (<prefix>.nodemem)
+NodeRoles g_nodeRoles;
+
+// Global routes computed once per topology and reused (--routeCache)
+RouteCache g_routeCache;
+
 // Trace callback functions to update the global variables
 void CwndTracer(uint32_t oldCwnd, uint32_t newCwnd) {
     g_cwnd = newCwnd / PACKET_SIZE;  // Convert to packets
@@ -63,7 +132,7 @@ void PacketSentCallback(Ptr<const Packet> packet) {
 }
 
 // Track packets received
-void PacketReceivedCallback(Ptr<const Packet> packet, const Address &address) {
+void PacketReceivedCallback(uint32_t flow, uint32_t bytes) {
     packetsReceived++;
 }
 
@@ -73,52 +142,56 @@ void CalculatePacketLoss(std::ofstream &packetLossFile) {
     if (packetsSent > 0) {
         double packetLoss = ((packetsSent - packetsReceived) / static_cast<double>(packetsSent)) * 100;
         packetLossFile << time << "\t" << packetLoss << std::endl;
+        g_metrics.Record(METRIC_PACKETLOSS, time, packetLoss);
     }
 
     // Schedule next packet loss calculation
-    Simulator::Schedule(Seconds(1.0), &CalculatePacketLoss, std::ref(packetLossFile));
+    Simulator::Schedule(Seconds(1.0), PROFILED(CalculatePacketLoss), std::ref(packetLossFile));
 }
 
 // Trace metrics (congestion window, RTT, throughput)
-void TraceMetrics(Ptr<PacketSink> sink, std::ofstream &throughputFile, std::ofstream &rttFile, std::ofstream &cwndFile) {
-    static uint64_t lastTotalRx = 0;
+void TraceMetrics(Ptr<FlowSink> sink, std::ofstream &throughputFile, std::ofstream &rttFile, std::ofstream &cwndFile) {
     double timeInSeconds = Simulator::Now().GetSeconds();
 
-    // Calculate throughput in Mbps
-    uint64_t totalRx = sink->GetTotalRx();
-    double throughput = ((totalRx - lastTotalRx) * 8.0) / 1e6; // Mbps
-    lastTotalRx = totalRx;
+    // Goodput and wire throughput in Mbps over the time since the last call
+    g_rate.Sample(sink->GetTotalRx());
+    double throughput = g_rate.GetGoodput();
 
     // Write metrics to files
-    throughputFile << timeInSeconds << "\t" << throughput << std::endl;
+    throughputFile << timeInSeconds << "\t" << throughput << "\t" << g_rate.GetWireThroughput() << std::endl;
+    g_metrics.Record(METRIC_THROUGHPUT, timeInSeconds, throughput);
+    g_metrics.RecordFlowThroughput(timeInSeconds, sink->GetFlows());
     rttFile << timeInSeconds << "\t" << (g_rtt * 1000) << std::endl; // RTT in milliseconds
+    g_metrics.Record(METRIC_RTT, timeInSeconds, g_rtt * 1000);
     cwndFile << timeInSeconds << "\t" << g_cwnd << std::endl;
+    g_metrics.Record(METRIC_CWND, timeInSeconds, g_cwnd);
+    g_steadyState.AddSample(throughput, g_rtt * 1000);
+    g_linkEvents.AddThroughputSample(throughput);
 
     // Schedule next call to TraceMetrics
-    Simulator::Schedule(Seconds(1.0), &TraceMetrics, sink, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
+    Simulator::Schedule(Seconds(1.0), PROFILED(TraceMetrics), sink, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
 }
 
 // Attach traces for congestion window and RTT
 void AttachTraces(Ptr<Application> app) {
-    Ptr<BulkSendApplication> bulkSendApp = DynamicCast<BulkSendApplication>(app);
-    if (bulkSendApp) {
-        Ptr<Socket> socket = bulkSendApp->GetSocket();
+    if (BulkSenderHelper::IsSender(app)) {
+        Ptr<Socket> socket = BulkSenderHelper::GetSocket(app);
         if (socket) {
             Ptr<QuicSocketBase> quicSocket = DynamicCast<QuicSocketBase>(socket);
             if (quicSocket) {
-                quicSocket->TraceConnectWithoutContext("CongestionWindow", MakeCallback(&CwndTracer));
-                quicSocket->TraceConnectWithoutContext("RTT", MakeCallback(&RttTracer));
+                quicSocket->TraceConnectWithoutContext("CongestionWindow", MakeCallback(PROFILED(CwndTracer)));
+                quicSocket->TraceConnectWithoutContext("RTT", MakeCallback(PROFILED(RttTracer)));
                 NS_LOG_INFO("Successfully attached traces for Cwnd and RTT.");
             } else {
                 NS_LOG_INFO("QUIC socket not available yet, retrying in 0.2 seconds...");
-                Simulator::Schedule(Seconds(0.2), &AttachTraces, app);  // Retry after 0.2 seconds
+                Simulator::Schedule(Seconds(0.2), PROFILED(AttachTraces), app);  // Retry after 0.2 seconds
             }
         } else {
             NS_LOG_INFO("Socket is null, retrying in 0.2 seconds...");
-            Simulator::Schedule(Seconds(0.2), &AttachTraces, app);  // Retry after 0.2 seconds
+            Simulator::Schedule(Seconds(0.2), PROFILED(AttachTraces), app);  // Retry after 0.2 seconds
         }
     } else {
-        NS_LOG_ERROR("Failed to get BulkSendApplication.");
+        NS_LOG_ERROR("Failed to get the bulk sender application.");
     }
 }
 
@@ -134,6 +207,40 @@ int main(int argc, char *argv[]) {
     uint32_t maxBytes = 0;
     uint32_t NUM_NODES = 10;  // Number of nodes
     double DURATION = 100.0;   // Simulation duration
+    bool steadyState = false;
+    double steadyWindow = 10.0;
+    double steadyTolerance = 0.05;
+    double steadyMinTime = 10.0;
+    uint32_t replications = 1;
+    double ciBinWidth = 1.0;
+    double snapshotTime = 0.0;
+    std::string snapshotBranches = "";
+    std::string linkEvents = "";
+    double recoveryWindow = 5.0;
+    double recoveryTolerance = 0.1;
+    bool ecmp = false;
+    uint32_t ecmpSlack = 0;
+    uint32_t flows = 1;
+    double linkStatsPeriod = 0.0;
+    std::string linkStatsFormat = "columnar";
+    std::string outputFormat = "text";
+    double flowStatsPeriod = 0.0;
+    int32_t flowStatsNode = -1;
+    bool profile = false;
+    std::string scheduler = "map";
+    std::string schedulerBenchmark = "";
+    std::string throughputMode = "window";
+    double bbrTracePeriod = 0.0;
+    bool recoveryStats = false;
+    bool hopLatency = false;
+    double churnRate = 0.0;
+    uint32_t churnRequest = 100;
+    uint32_t churnResponse = 1000;
+    bool churnZeroRtt = false;
+    bool fullStacks = false;
+    std::string sender = "virtual";
+    bool senderBenchmark = false;
+    std::string routeCache = "";
     bool isPacingEnabled = true;
     std::string pacingRate = "10Mbps";
 
@@ -145,8 +252,99 @@ int main(int argc, char *argv[]) {
     cmd.AddValue("maxBytes", "Total number of bytes for application to send", maxBytes);
     cmd.AddValue("Pacing", "Flag to enable/disable pacing in QUIC", isPacingEnabled);
     cmd.AddValue("PacingRate", "Max Pacing Rate in bps", pacingRate);
+    cmd.AddValue("steadyState", "Stop the run once throughput and RTT are stable", steadyState);
+    cmd.AddValue("steadyWindow", "Steady-state detection window in seconds", steadyWindow);
+    cmd.AddValue("steadyTolerance", "Maximum coefficient of variation considered stable", steadyTolerance);
+    cmd.AddValue("steadyMinTime", "Earliest time in seconds at which the run may stop", steadyMinTime);
+    cmd.AddValue("replications", "Number of independent replications (RngRun, RngRun+1, ...)", replications);
+    cmd.AddValue("ciBinWidth", "Time bin in seconds for the replication confidence intervals", ciBinWidth);
+    cmd.AddValue("snapshotTime", "Warm-up time in seconds after which the run forks into branches", snapshotTime);
+    cmd.AddValue("snapshotBranches", "Per-branch Config paths to change, e.g. \"path=value,...;path=value\"", snapshotBranches);
+    cmd.AddValue("linkEvents", "Link event timeline, e.g. \"10s:rate:1:2Mbps;30s:down:0;40s:up:0\"", linkEvents);
+    cmd.AddValue("recoveryWindow", "Window in seconds used to detect throughput re-convergence", recoveryWindow);
+    cmd.AddValue("recoveryTolerance", "Coefficient of variation at which throughput counts as re-converged", recoveryTolerance);
+    cmd.AddValue("ecmp", "Spread flows over all equal-cost paths with flow-hashed ECMP", ecmp);
+    cmd.AddValue("ecmpSlack", "Extra hops the sending node may detour over with ECMP", ecmpSlack);
+    cmd.AddValue("flows", "Number of parallel bulk flows from the client to the server", flows);
+    cmd.AddValue("linkStatsPeriod", "Per-link utilization/queue sampling period in seconds (0 = off)", linkStatsPeriod);
+    cmd.AddValue("linkStatsFormat", "Link statistics file format: columnar or text", linkStatsFormat);
+    cmd.AddValue("outputFormat", "Metric output format: text (one file per metric) or columnar (one .ncol file)", outputFormat);
+    cmd.AddValue("flowStatsPeriod", "Per-flow summary export period in seconds (0 = off)", flowStatsPeriod);
+    cmd.AddValue("flowStatsNode", "Node whose received flows are aggregated (-1 = the server)", flowStatsNode);
+    cmd.AddValue("profile", "Time every scenario callback and write quicbbr.profile", profile);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar or priorityqueue", scheduler);
+    cmd.AddValue("schedulerBenchmark", "Run once per scheduler (\"all\" or e.g. \"map,heap\") and report events/s", schedulerBenchmark);
+    cmd.AddValue("throughputMode", "Throughput estimate: window (per sampling interval) or ewma:<seconds>", throughputMode);
+    cmd.AddValue("bbrTracePeriod", "BBR state sampling period in seconds (0 = off)", bbrTracePeriod);
+    cmd.AddValue("recoveryStats", "Write lost-packet and PTO events and totals per flow", recoveryStats);
+    cmd.AddValue("hopLatency", "Per-hop delay histograms and one-way delay per node pair (quicbbr.hops)", hopLatency);
+    cmd.AddValue("churnRate", "Short connections per second from every client (0 = off)", churnRate);
+    cmd.AddValue("churnRequest", "Request size in bytes of a short connection", churnRequest);
+    cmd.AddValue("churnResponse", "Response size in bytes of a short connection", churnResponse);
+    cmd.AddValue("churnZeroRtt", "Send the short-connection request with the first QUIC flight (0-RTT)", churnZeroRtt);
+    cmd.AddValue("fullStacks", "Install the full internet stack and QUIC on routers too", fullStacks);
+    cmd.AddValue("sender", "Bulk sender: virtual (shared payload, batched writes) or bulk (BulkSendApplication)", sender);
+    cmd.AddValue("senderBenchmark", "Run once with each bulk sender and report events/s and peak RSS", senderBenchmark);
+    cmd.AddValue("routeCache", "Directory of global routes cached per topology (empty = compute every run)", routeCache);
     cmd.Parse(argc, argv);
 
+    if (steadyState) {
+        g_steadyState.Enable(steadyWindow, steadyTolerance, steadyMinTime);
+    }
+
+    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/"; //CHANGE THIS
+
+    if (snapshotTime > 0 && replications > 1) {
+        std::cerr << "--snapshotTime cannot be combined with --replications" << std::endl;
+        return 1;
+    }
+
+    if ((!schedulerBenchmark.empty() || senderBenchmark) && (replications > 1 || snapshotTime > 0)) {
+        std::cerr << "--schedulerBenchmark and --senderBenchmark cannot be combined with --replications or --snapshotTime"
+                  << std::endl;
+        return 1;
+    }
+
+    if (!schedulerBenchmark.empty() && senderBenchmark) {
+        std::cerr << "--schedulerBenchmark cannot be combined with --senderBenchmark" << std::endl;
+        return 1;
+    }
+
+    // Each replication runs in a child process; the parent only aggregates their samples
+    if (replications > 1 && g_replication.Fork(replications, ciBinWidth) < 0) {
+        EnsureDirectoryExists(outputDir);
+        g_replication.WriteConfidenceIntervals(outputDir + "quicbbr");
+        return 0;
+    }
+
+    // Same scenario once per scheduler, each in a child process; the parent only reports events/s
+    if (!schedulerBenchmark.empty() &&
+        g_schedulers.Fork(schedulerBenchmark, scheduler, outputDir + "quicbbr.schedulers") < 0) {
+        return 0;
+    }
+
+    // Same scenario once per bulk sender, each in a child process; the parent reports events/s and RSS
+    if (senderBenchmark &&
+        g_schedulers.ForkEach("sender", {"bulk", "virtual"}, sender, outputDir + "quicbbr.senders") < 0) {
+        return 0;
+    }
+    if (!BulkSenderHelper::Use(sender)) {
+        return 1;
+    }
+    g_routeCache.Configure(routeCache);
+    if (!SchedulerBenchmark::Apply(scheduler)) {
+        return 1;
+    }
+    if (!g_rate.Configure(throughputMode)) {
+        return 1;
+    }
+    if (bbrTracePeriod > 0) {
+        g_bbr.Configure(Seconds(bbrTracePeriod), g_metrics);
+    }
+    if (recoveryStats) {
+        g_recovery.Configure(g_metrics);
+    }
+
     Config::SetDefault("ns3::TcpSocketState::MaxPacingRate", StringValue(pacingRate));
     Config::SetDefault("ns3::TcpSocketState::EnablePacing", BooleanValue(isPacingEnabled));
 
@@ -154,16 +352,20 @@ int main(int argc, char *argv[]) {
     NodeContainer nodes;
     nodes.Create(NUM_NODES); // Create 10 nodes
 
-    // Install Internet stack on all nodes
-    InternetStackHelper stack;
-    stack.Install(nodes);
+    // Full stack on the endpoints, IPv4 forwarding only on the routers unless --fullStacks
+    NodeContainer endpoints(nodes.Get(0), nodes.Get(NUM_NODES - 1));
+    g_nodeRoles.Install(nodes, fullStacks ? nodes : endpoints);
 
-    // Install QUIC on all nodes
+    // QUIC on the endpoints only
     QuicHelper quic;
-    quic.InstallQuic(nodes);
+    g_nodeRoles.InstallEndpoints([&quic](NodeContainer node) { quic.InstallQuic(node); });
 
     // Set QUIC to use BBR congestion control
     Config::SetDefault("ns3::QuicL4Protocol::SocketType", StringValue("ns3::QuicBbr"));
+    if (g_bbr.IsEnabled() || g_recovery.IsEnabled()) {
+        // Same controller, registered with the BBR tracer and the loss-recovery statistics
+        Config::SetDefault("ns3::QuicL4Protocol::SocketType", StringValue(TracedQuicBbr::GetTypeId().GetName()));
+    }
 
     NS_LOG_INFO("Create channels.");
     PointToPointHelper pointToPoint;
@@ -178,6 +380,8 @@ int main(int argc, char *argv[]) {
     for (uint32_t i = 0; i < nodes.GetN(); ++i) {
         for (uint32_t j = i + 1; j < nodes.GetN(); ++j) {
             devices = pointToPoint.Install(NodeContainer(nodes.Get(i), nodes.Get(j)));
+            g_linkEvents.AddLink(devices);
+            g_linkMonitor.AddLink(devices);
             std::ostringstream subnetStream;
             subnetStream << "10.1." << subnet++ << ".0";
             address.SetBase(subnetStream.str().c_str(), "255.255.255.0");
@@ -185,15 +389,25 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    g_routeCache.Populate("quicbbr-Mesh-" + std::to_string(nodes.GetN()));
+
+    if (!linkEvents.empty()) {
+        g_linkEvents.SetRecoveryCriterion(recoveryWindow, recoveryTolerance);
+        g_linkEvents.Schedule(linkEvents);
+    }
+
+    // Flow-hashed ECMP above global routing, which still handles local delivery
+    if (ecmp) {
+        EcmpRouting::Install(nodes, ecmpSlack);
+    }
 
     NS_LOG_INFO("Create Applications.");
     ApplicationContainer sourceApps;
     ApplicationContainer sinkApps;
     uint16_t port = 10000;
 
-    // Install PacketSink on the last node (server)
-    PacketSinkHelper sinkHelper("ns3::QuicSocketFactory",
+    // Install FlowSink on the last node (server)
+    FlowSinkHelper sinkHelper("ns3::QuicSocketFactory",
                                 InetSocketAddress(Ipv4Address::GetAny(), port));
     ApplicationContainer sinkApp = sinkHelper.Install(nodes.Get(NUM_NODES - 1));
     sinkApp.Start(Seconds(0.0));
@@ -203,38 +417,134 @@ int main(int argc, char *argv[]) {
     Ptr<Ipv4> ipv4Server = nodes.Get(NUM_NODES - 1)->GetObject<Ipv4>();
     Ipv4Address serverAddress = ipv4Server->GetAddress(1, 0).GetLocal();
 
-    // Install BulkSendApplication on the first node (client)
-    BulkSendHelper source("ns3::QuicSocketFactory",
-                          InetSocketAddress(serverAddress, port));
+    // Install the bulk sender on the first node (client)
+    BulkSenderHelper source("ns3::QuicSocketFactory",
+                            InetSocketAddress(serverAddress, port));
     source.SetAttribute("MaxBytes", UintegerValue(maxBytes));
     ApplicationContainer clientApp = source.Install(nodes.Get(0));
     sourceApps.Add(clientApp);
+    // Additional parallel flows; with ECMP each one targets the next server address so that the
+    // sender, which hashes UDP flows without their ports, can tell QUIC flows apart as well
+    for (uint32_t k = 1; k < flows; ++k) {
+        uint32_t serverInterface = ecmp ? 1 + k % (ipv4Server->GetNInterfaces() - 1) : 1;
+        source.SetAttribute("Remote", AddressValue(InetSocketAddress(ipv4Server->GetAddress(serverInterface, 0).GetLocal(), port)));
+        sourceApps.Add(source.Install(nodes.Get(0)));
+    }
 
     // Schedule trace attachment
     Ptr<Application> app = clientApp.Get(0);
-    Simulator::Schedule(Seconds(0.1), &AttachTraces, app);
+    Simulator::Schedule(Seconds(0.1), PROFILED(AttachTraces), app);
+
+    // Short request/response connections to the server next to the bulk flow (--churnRate)
+    if (churnRate > 0) {
+        if (churnZeroRtt && !ChurnWorkload::EnableZeroRtt()) {
+            return 1;
+        }
+        g_churn.Configure("ns3::QuicSocketFactory", churnRate, churnRequest, churnResponse, churnZeroRtt,
+                          g_metrics);
+        ApplicationContainer churnServer = g_churn.InstallServer(nodes.Get(NUM_NODES - 1));
+        churnServer.Start(Seconds(0.0));
+        churnServer.Stop(Seconds(DURATION));
+        ApplicationContainer churnClients = g_churn.InstallClient(nodes.Get(0), serverAddress);
+        churnClients.Start(Seconds(1.0));
+        churnClients.Stop(Seconds(DURATION));
+    }
 
     // Open output files
-    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/"; //CHANGE THIS
     EnsureDirectoryExists(outputDir);
 
-    std::ofstream throughputFile(outputDir + "quicbbr.throughput");
-    std::ofstream rttFile(outputDir + "quicbbr.rtt");
-    std::ofstream cwndFile(outputDir + "quicbbr.cwnd");
-    std::ofstream packetLossFile(outputDir + "quicbbr.packetloss");
+    // --outputFormat=columnar replaces the four text series with one <prefix>.ncol file
+    if (outputFormat == "columnar") {
+        g_metrics.Open(g_replication.OutputPath(outputDir + "quicbbr.ncol"), "quicbbr", "Mesh", DURATION, argc, argv);
+    }
+
+    std::ofstream throughputFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.throughput")));
+    std::ofstream rttFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.rtt")));
+    std::ofstream cwndFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.cwnd")));
+    std::ofstream packetLossFile(g_metrics.TextPath(g_replication.OutputPath(outputDir + "quicbbr.packetloss")));
+
+    // One columnar file for all link telemetry unless --linkStatsFormat=text
+    std::string linkStatsFile = outputDir + "quicbbr.links" + (linkStatsFormat == "text" ? "" : ".ncol");
+    if (linkStatsPeriod > 0) {
+        g_linkMonitor.Start(Seconds(linkStatsPeriod), g_replication.OutputPath(linkStatsFile), linkStatsFormat != "text");
+    }
+
+    // IPFIX-like flow records of the packets reaching one node
+    std::string flowStatsFile = outputDir + "quicbbr.flows";
+    if (flowStatsPeriod > 0) {
+        if (flowStatsNode >= static_cast<int32_t>(NodeList::GetNNodes())) {
+            std::cerr << "--flowStatsNode must be below " << NodeList::GetNNodes() << std::endl;
+            return 1;
+        }
+        Ptr<Node> flowNode = flowStatsNode >= 0 ? NodeList::GetNode(flowStatsNode) : nodes.Get(NUM_NODES - 1);
+        g_flowStats.Start(flowNode, Seconds(flowStatsPeriod), g_replication.OutputPath(flowStatsFile));
+    }
+
+    // BtlBw, RTprop, gains and state of every BBR controller
+    std::string bbrFile = g_metrics.TextPath(outputDir + "quicbbr.bbr");
+    if (g_bbr.IsEnabled()) {
+        g_bbr.Start(g_replication.OutputPath(bbrFile));
+    }
+
+    // Lost packets and PTOs of every flow
+    std::string recoveryFile = g_metrics.TextPath(outputDir + "quicbbr.recovery");
+    if (g_recovery.IsEnabled()) {
+        g_recovery.Start(g_replication.OutputPath(recoveryFile));
+    }
+
+    // Per-hop delay decomposition and one-way delays, read by tags on the packets
+    if (hopLatency) {
+        g_hopLatency.Install();
+    }
+
+    // Handshake, time to first byte and completion of every short connection
+    std::string churnFile = g_metrics.TextPath(outputDir + "quicbbr.churn");
+    if (g_churn.IsEnabled()) {
+        g_churn.Start(g_replication.OutputPath(churnFile));
+    }
+
+    // Every snapshot branch continues these series in its own files
+    g_snapshot.AddOutput(throughputFile, g_metrics.TextPath(outputDir + "quicbbr.throughput"));
+    g_snapshot.AddOutput(rttFile, g_metrics.TextPath(outputDir + "quicbbr.rtt"));
+    g_snapshot.AddOutput(cwndFile, g_metrics.TextPath(outputDir + "quicbbr.cwnd"));
+    g_snapshot.AddOutput(packetLossFile, g_metrics.TextPath(outputDir + "quicbbr.packetloss"));
+    if (linkStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_linkMonitor.GetSeriesStream(), linkStatsFile);
+    }
+    if (flowStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_flowStats.GetStream(), flowStatsFile);
+    }
+    if (g_bbr.IsEnabled()) {
+        g_snapshot.AddOutput(g_bbr.GetStream(), bbrFile);
+    }
+    if (g_recovery.IsEnabled()) {
+        g_snapshot.AddOutput(g_recovery.GetStream(), recoveryFile);
+    }
+    if (g_churn.IsEnabled()) {
+        g_snapshot.AddOutput(g_churn.GetStream(), churnFile);
+    }
+    if (g_metrics.IsEnabled()) {
+        g_snapshot.AddOutput(g_metrics.GetStream(), outputDir + "quicbbr.ncol");
+    }
+    if (snapshotTime > 0) {
+        g_snapshot.Schedule(Seconds(snapshotTime), snapshotBranches);
+    }
 
-    // Get the PacketSink pointer
-    Ptr<PacketSink> sinkPtr = DynamicCast<PacketSink>(sinkApp.Get(0));
+    // Get the FlowSink pointer
+    Ptr<FlowSink> sinkPtr = DynamicCast<FlowSink>(sinkApp.Get(0));
 
     // Schedule the first call to TraceMetrics at t = 1 second
-    Simulator::Schedule(Seconds(1.0), &TraceMetrics, sinkPtr, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
+    g_rate.WatchNode(sinkPtr->GetNode());
+    Simulator::Schedule(Seconds(1.0), PROFILED(TraceMetrics), sinkPtr, std::ref(throughputFile), std::ref(rttFile), std::ref(cwndFile));
 
     // Schedule packet loss calculation
-    Simulator::Schedule(Seconds(1.0), &CalculatePacketLoss, std::ref(packetLossFile));
+    Simulator::Schedule(Seconds(1.0), PROFILED(CalculatePacketLoss), std::ref(packetLossFile));
 
     // Connect the callbacks for packet tracking
-    sourceApps.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
-    sinkApps.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PacketReceivedCallback));
+    for (uint32_t k = 0; k < sourceApps.GetN(); ++k) {
+        sourceApps.Get(k)->TraceConnectWithoutContext("Tx", MakeCallback(PROFILED(PacketSentCallback)));
+    }
+    sinkApps.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(PROFILED(PacketReceivedCallback)));
 
     // Start applications
     sinkApps.Start(Seconds(0.0));
@@ -244,13 +554,35 @@ int main(int argc, char *argv[]) {
 
     // Run the simulation for the specified duration
     Simulator::Stop(Seconds(DURATION));
-    Simulator::Run();
+    if (profile) {
+        g_profiler.Start();
+    }
+    g_schedulers.Run();
+    g_profiler.Stop();
+
+    g_steadyState.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.steadystate")));
+    g_linkEvents.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.linkevents")));
+    g_linkMonitor.WriteHotspotReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.hotspots")));
+    g_profiler.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.profile")));
+    g_bbr.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.bbrstates")));
+    g_recovery.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.recoverystats")));
+    g_hopLatency.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.hops")));
+    g_hopLatency.WriteHistograms(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.hophist")));
+    g_churn.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.churnstats")));
+    g_nodeRoles.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "quicbbr.nodemem")));
+    g_snapshot.WaitForBranches();
 
     // Close the output files
     throughputFile.close();
     rttFile.close();
     cwndFile.close();
     packetLossFile.close();
+    g_linkMonitor.Close();
+    g_metrics.Close();
+    g_flowStats.Close();
+    g_bbr.Close();
+    g_recovery.Close();
+    g_churn.Close();
 
     Simulator::Destroy();
 
@@ -39,6 +39,27 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/tcp-socket-base.h"
+#include "../common/steady-state-monitor.h"
+#include "../common/replication.h"
+#include "../common/snapshot-fork.h"
+#include "../common/link-events.h"
+#include "../common/ecmp-routing.h"
+#include "../common/link-monitor.h"
+#include "../common/metric-store.h"
+#include "../common/flow-aggregator.h"
+#include "../common/callback-profiler.h"
+#include "../common/scheduler-bench.h"
+#include "../common/flow-sink.h"
+#include "../common/rate-estimator.h"
+#include "../common/trace-batcher.h"
+#include "../common/socket-registry.h"
+#include "../common/cubic-tracer.h"
+#include "../common/loss-recovery.h"
+#include "../common/hop-latency.h"
+#include "../common/churn-workload.h"
+#include "../common/node-roles.h"
+#include "../common/bulk-sender.h"
+#include "../common/route-cache.h"
 
 #define TCP_SEGMENT_SIZE 1500  // Match QUIC packet size
 #define DATA_RATE "5Mbps"      // Match QUIC data rate
@@ -49,12 +70,69 @@
 
 using namespace ns3;
 
-Ptr<PacketSink> sink;
-uint64_t lastTotalRx = 0;
+Ptr<FlowSink> sink;
 uint64_t totalPacketsSent = 0;
 uint64_t totalPacketsReceived = 0;
 std::ofstream cwndFile, rttFile, throughputFile, packetLossFile;
 
+// Latest RTT sample in milliseconds, fed to the steady-state monitor
+double g_lastRtt = 0;
+
+// Optional early termination once throughput and RTT settle
+SteadyStateMonitor g_steadyState;
+
+// Multi-seed replication driver (--replications)
+ReplicationRunner g_replication;
+
+// Fork-based branching after the warm-up period (--snapshotTime)
+SnapshotBrancher g_snapshot;
+
+// Scheduled link rate/delay changes and failures (--linkEvents)
+LinkEventTimeline g_linkEvents;
+
+// Per-link utilization and queue sampling (--linkStatsPeriod)
+LinkMonitor g_linkMonitor;
+
+// Every sampled metric goes through here (replication, --outputFormat=columnar)
+MetricStore g_metrics(g_replication);
+
+// Per-flow counters at the server (--flowStatsPeriod)
+FlowAggregator g_flowStats;
+
+// Per-callback call counts and time (--profile)
+CallbackProfiler &g_profiler = CallbackProfiler::Instance();
+
+// Event scheduler choice and --schedulerBenchmark runs
+SchedulerBenchmark g_schedulers(g_replication);
+
+// Goodput and wire throughput per sampling interval (--throughputMode)
+RateEstimator g_rate;
+
+// Per-flow cwnd/RTT windows instead of one line per trace call (--traceBatch)
+TraceBatcher g_cwndBatch(g_metrics, METRIC_CWND);
+TraceBatcher g_rttBatch(g_metrics, METRIC_RTT);
+
+// Every TCP socket, traced from its creation or accept
+SocketRegistry g_sockets;
+
+// CUBIC W_max, K, epochs and slow-start exits per flow (--cubicTrace)
+CubicTracer &g_cubic = CubicTracer::Instance();
+
+// Retransmissions, timeouts and spurious recovery per flow (--recoveryStats)
+LossRecoveryStats &g_recovery = LossRecoveryStats::Instance();
+
+// Queue, serialization and propagation time per hop (--hopLatency)
+HopLatencyMonitor g_hopLatency;
+
+// Short connections measuring handshake and time to first byte (--churnRate)
+ChurnWorkload g_churn;
+
+// Endpoint and router stacks, stack memory per node (<prefix>.nodemem)
+NodeRoles g_nodeRoles;
+
+// Global routes computed once per topology and reused (--routeCache)
+RouteCache g_routeCache;
+
 // Function to track packet transmissions (sent packets)
 static void PacketSent(Ptr<const Packet> p) {
     totalPacketsSent++;
@@ -71,26 +149,38 @@ static void CalculatePacketLoss() {
     if (totalPacketsSent > 0) {
         double packetLossPercent = (1 - (double)totalPacketsReceived / totalPacketsSent) * 100;
         packetLossFile << time << " " << packetLossPercent << std::endl;
+        g_metrics.Record(METRIC_PACKETLOSS, time, packetLossPercent);
         std::cout << std::setw(10) << "Time" << std::setw(25) << "Packet Loss (%)" << std::endl;
         std::cout << std::setw(10) << time << std::setw(25) << packetLossPercent << std::endl;
     }
-    Simulator::Schedule(Seconds(1.0), &CalculatePacketLoss);  // Schedule to run every second
+    Simulator::Schedule(Seconds(1.0), PROFILED(CalculatePacketLoss));  // Schedule to run every second
 }
 
 // Cwnd change function
-static void CwndChange(uint32_t oldCwnd, uint32_t newCwnd) {
+static void CwndChange(uint32_t flow, uint32_t oldCwnd, uint32_t newCwnd) {
     double time = Simulator::Now().GetSeconds();
     double g_cwnd = newCwnd / TCP_SEGMENT_SIZE;  // Convert to packets
+    if (g_cwndBatch.IsEnabled()) {
+        g_cwndBatch.Update(flow, time, g_cwnd);
+        return;
+    }
     cwndFile << time << " " << g_cwnd << std::endl;
+    g_metrics.Record(METRIC_CWND, time, g_cwnd);
     std::cout << std::setw(10) << "Time" << std::setw(15) << "Cwnd (Packets)" << std::endl;
     std::cout << std::setw(10) << time << std::setw(15) << g_cwnd << std::endl;
 }
 
 // RTT change function
-static void RttChange(Time oldRtt, Time newRtt) {
+static void RttChange(uint32_t flow, Time oldRtt, Time newRtt) {
     double time = Simulator::Now().GetSeconds();
     double g_rtt = newRtt.GetMilliSeconds();  // RTT in milliseconds
+    g_lastRtt = g_rtt;
+    if (g_rttBatch.IsEnabled()) {
+        g_rttBatch.Update(flow, time, g_rtt);
+        return;
+    }
     rttFile << time << " " << g_rtt << std::endl;
+    g_metrics.Record(METRIC_RTT, time, g_rtt);
     std::cout << std::setw(10) << "Time" << std::setw(25) << "RTT (ms)" << std::endl;
     std::cout << std::setw(10) << time << std::setw(25) << g_rtt << std::endl;
 }
@@ -99,46 +189,163 @@ static void RttChange(Time oldRtt, Time newRtt) {
 static void findThroughput() {
     Time currentTime = Simulator::Now();
     double time = currentTime.GetSeconds();
-    double currentThroughput = (sink->GetTotalRx() - lastTotalRx) * 8.0 / 1e6;  // Converted to Mbps
-    throughputFile << time << " " << currentThroughput << std::endl;
+    g_rate.Sample(sink->GetTotalRx());
+    double currentThroughput = g_rate.GetGoodput();  // Mbps over the time since the last sample
+    throughputFile << time << " " << currentThroughput << " " << g_rate.GetWireThroughput() << std::endl;
+    g_metrics.Record(METRIC_THROUGHPUT, time, currentThroughput);
+    g_metrics.RecordFlowThroughput(time, sink->GetFlows());
+    g_steadyState.AddSample(currentThroughput, g_lastRtt);
+    g_linkEvents.AddThroughputSample(currentThroughput);
     std::cout << std::setw(10) << "Time" << std::setw(20) << "Throughput (Mbps)" << std::endl;
     std::cout << std::setw(10) << time << std::setw(20) << currentThroughput << std::endl;
-    lastTotalRx = sink->GetTotalRx();
-    Simulator::Schedule(Seconds(1.0), &findThroughput);  // Sample throughput every 1 second
+    Simulator::Schedule(Seconds(1.0), PROFILED(findThroughput));  // Sample throughput every 1 second
 }
 
-// Function to trace Cwnd and RTT for a given socket
-static void TraceCwndRtt(Ptr<Socket> socket) {
-    Ptr<TcpSocketBase> tcpSocket = DynamicCast<TcpSocketBase>(socket);
-    if (tcpSocket) {
-        tcpSocket->TraceConnectWithoutContext("CongestionWindow", MakeCallback(&CwndChange));
-        tcpSocket->TraceConnectWithoutContext("RTT", MakeCallback(&RttChange));
-        std::cout << "Traces attached to the socket" << std::endl;
-    } else {
-        std::cout << "Failed to attach traces. Socket is not a TcpSocketBase." << std::endl;
-    }
-}
-
-// Function to extract socket from BulkSendApplication and attach traces
-static void AttachSocketTraces(Ptr<Application> app) {
-    Ptr<BulkSendApplication> bulkSendApp = DynamicCast<BulkSendApplication>(app);
-    if (bulkSendApp) {
-        Ptr<Socket> socket = bulkSendApp->GetSocket();
-        if (socket) {
-            TraceCwndRtt(socket);
-        } else {
-            std::cout << "Socket not available yet. Retrying in 0.1s." << std::endl;
-            Simulator::Schedule(Seconds(0.1), &AttachSocketTraces, app);  // Retry after 0.1 seconds
-        }
-    } else {
-        std::cout << "Application is not a BulkSendApplication." << std::endl;
-    }
+// Hook cwnd and RTT of every TCP socket when it is created or accepted
+static void AttachSocketTraces(uint32_t flow, Ptr<TcpSocketBase> socket) {
+    socket->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback(PROFILED(CwndChange), flow));
+    socket->TraceConnectWithoutContext("RTT", MakeBoundCallback(PROFILED(RttChange), flow));
 }
 
 int main(int argc, char *argv[]) {
+    bool steadyState = false;
+    double steadyWindow = 10.0;
+    double steadyTolerance = 0.05;
+    double steadyMinTime = 10.0;
+    uint32_t replications = 1;
+    double ciBinWidth = 1.0;
+    double snapshotTime = 0.0;
+    std::string snapshotBranches = "";
+    std::string linkEvents = "";
+    double recoveryWindow = 5.0;
+    double recoveryTolerance = 0.1;
+    bool ecmp = false;
+    uint32_t ecmpSlack = 0;
+    uint32_t flows = 1;
+    uint32_t serverNode = NUM_NODES - 1;
+    double linkStatsPeriod = 0.0;
+    std::string linkStatsFormat = "columnar";
+    std::string outputFormat = "text";
+    double flowStatsPeriod = 0.0;
+    int32_t flowStatsNode = -1;
+    bool profile = false;
+    std::string scheduler = "map";
+    std::string schedulerBenchmark = "";
+    std::string traceBatch = "off";
+    std::string throughputMode = "window";
+    bool cubicTrace = false;
+    bool recoveryStats = false;
+    bool hopLatency = false;
+    double churnRate = 0.0;
+    uint32_t churnRequest = 100;
+    uint32_t churnResponse = 1000;
+    bool fullStacks = false;
+    std::string sender = "virtual";
+    bool senderBenchmark = false;
+    std::string routeCache = "";
+
     CommandLine cmd;
+    cmd.AddValue("steadyState", "Stop the run once throughput and RTT are stable", steadyState);
+    cmd.AddValue("steadyWindow", "Steady-state detection window in seconds", steadyWindow);
+    cmd.AddValue("steadyTolerance", "Maximum coefficient of variation considered stable", steadyTolerance);
+    cmd.AddValue("steadyMinTime", "Earliest time in seconds at which the run may stop", steadyMinTime);
+    cmd.AddValue("replications", "Number of independent replications (RngRun, RngRun+1, ...)", replications);
+    cmd.AddValue("ciBinWidth", "Time bin in seconds for the replication confidence intervals", ciBinWidth);
+    cmd.AddValue("snapshotTime", "Warm-up time in seconds after which the run forks into branches", snapshotTime);
+    cmd.AddValue("snapshotBranches", "Per-branch Config paths to change, e.g. \"path=value,...;path=value\"", snapshotBranches);
+    cmd.AddValue("linkEvents", "Link event timeline, e.g. \"10s:rate:1:2Mbps;30s:down:0;40s:up:0\"", linkEvents);
+    cmd.AddValue("recoveryWindow", "Window in seconds used to detect throughput re-convergence", recoveryWindow);
+    cmd.AddValue("recoveryTolerance", "Coefficient of variation at which throughput counts as re-converged", recoveryTolerance);
+    cmd.AddValue("ecmp", "Spread flows over all equal-cost paths with flow-hashed ECMP", ecmp);
+    cmd.AddValue("ecmpSlack", "Extra hops the sending node may detour over with ECMP", ecmpSlack);
+    cmd.AddValue("flows", "Number of parallel bulk flows from the client to the server", flows);
+    cmd.AddValue("serverNode", "Ring node hosting the server (5 is opposite the client)", serverNode);
+    cmd.AddValue("linkStatsPeriod", "Per-link utilization/queue sampling period in seconds (0 = off)", linkStatsPeriod);
+    cmd.AddValue("linkStatsFormat", "Link statistics file format: columnar or text", linkStatsFormat);
+    cmd.AddValue("outputFormat", "Metric output format: text (one file per metric) or columnar (one .ncol file)", outputFormat);
+    cmd.AddValue("flowStatsPeriod", "Per-flow summary export period in seconds (0 = off)", flowStatsPeriod);
+    cmd.AddValue("flowStatsNode", "Node whose received flows are aggregated (-1 = the server)", flowStatsNode);
+    cmd.AddValue("profile", "Time every scenario callback and write tcpcubic.profile", profile);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar or priorityqueue", scheduler);
+    cmd.AddValue("schedulerBenchmark", "Run once per scheduler (\"all\" or e.g. \"map,heap\") and report events/s", schedulerBenchmark);
+    cmd.AddValue("traceBatch", "cwnd/RTT output per flow and window: off, rtt or a window in seconds", traceBatch);
+    cmd.AddValue("throughputMode", "Throughput estimate: window (per sampling interval) or ewma:<seconds>", throughputMode);
+    cmd.AddValue("cubicTrace", "Write CUBIC W_max, K, epoch and slow-start exits per flow to tcpcubic.cubic", cubicTrace);
+    cmd.AddValue("recoveryStats", "Write retransmission and loss-recovery events and totals per flow", recoveryStats);
+    cmd.AddValue("hopLatency", "Per-hop delay histograms and one-way delay per node pair (tcpcubic.hops)", hopLatency);
+    cmd.AddValue("churnRate", "Short connections per second from every client (0 = off)", churnRate);
+    cmd.AddValue("churnRequest", "Request size in bytes of a short connection", churnRequest);
+    cmd.AddValue("churnResponse", "Response size in bytes of a short connection", churnResponse);
+    cmd.AddValue("fullStacks", "Install the full internet stack on routers too", fullStacks);
+    cmd.AddValue("sender", "Bulk sender: virtual (shared payload, batched writes) or bulk (BulkSendApplication)", sender);
+    cmd.AddValue("senderBenchmark", "Run once with each bulk sender and report events/s and peak RSS", senderBenchmark);
+    cmd.AddValue("routeCache", "Directory of global routes cached per topology (empty = compute every run)", routeCache);
     cmd.Parse(argc, argv);
 
+    if (serverNode == 0 || serverNode >= NUM_NODES) {
+        std::cerr << "--serverNode must be between 1 and " << NUM_NODES - 1 << std::endl;
+        return 1;
+    }
+
+    if (steadyState) {
+        g_steadyState.Enable(steadyWindow, steadyTolerance, steadyMinTime);
+    }
+
+    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/";//CHANGE THIS
+
+    if (snapshotTime > 0 && replications > 1) {
+        std::cerr << "--snapshotTime cannot be combined with --replications" << std::endl;
+        return 1;
+    }
+
+    if ((!schedulerBenchmark.empty() || senderBenchmark) && (replications > 1 || snapshotTime > 0)) {
+        std::cerr << "--schedulerBenchmark and --senderBenchmark cannot be combined with --replications or --snapshotTime"
+                  << std::endl;
+        return 1;
+    }
+
+    if (!schedulerBenchmark.empty() && senderBenchmark) {
+        std::cerr << "--schedulerBenchmark cannot be combined with --senderBenchmark" << std::endl;
+        return 1;
+    }
+
+    // Each replication runs in a child process; the parent only aggregates their samples
+    if (replications > 1 && g_replication.Fork(replications, ciBinWidth) < 0) {
+        g_replication.WriteConfidenceIntervals(outputDir + "tcpcubic");
+        return 0;
+    }
+
+    // Same scenario once per scheduler, each in a child process; the parent only reports events/s
+    if (!schedulerBenchmark.empty() &&
+        g_schedulers.Fork(schedulerBenchmark, scheduler, outputDir + "tcpcubic.schedulers") < 0) {
+        return 0;
+    }
+
+    // Same scenario once per bulk sender, each in a child process; the parent reports events/s and RSS
+    if (senderBenchmark &&
+        g_schedulers.ForkEach("sender", {"bulk", "virtual"}, sender, outputDir + "tcpcubic.senders") < 0) {
+        return 0;
+    }
+    if (!BulkSenderHelper::Use(sender)) {
+        return 1;
+    }
+    g_routeCache.Configure(routeCache);
+    if (!SchedulerBenchmark::Apply(scheduler)) {
+        return 1;
+    }
+    if (!g_rate.Configure(throughputMode)) {
+        return 1;
+    }
+    if (!g_cwndBatch.Configure(traceBatch, &g_rttBatch) || !g_rttBatch.Configure(traceBatch, &g_rttBatch)) {
+        return 1;
+    }
+    if (recoveryStats) {
+        g_recovery.Configure(g_metrics);
+    }
+    if (cubicTrace) {
+        g_cubic.Configure(g_metrics);
+    }
+
     int tcpSegmentSize = TCP_SEGMENT_SIZE;
     Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(tcpSegmentSize));
     Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(2));
@@ -152,8 +359,11 @@ int main(int argc, char *argv[]) {
     pointToPoint.SetChannelAttribute("Delay", StringValue(RING_DELAY));
 
     NetDeviceContainer devices;
-    InternetStackHelper stack;
-    stack.Install(nodes);
+    // Full stack on the endpoints, IPv4 forwarding only on the routers unless --fullStacks
+    NodeContainer endpoints(nodes.Get(0), nodes.Get(serverNode));
+    g_nodeRoles.Install(nodes, fullStacks ? nodes : endpoints);
+    g_sockets.AddHook(PROFILED(AttachSocketTraces));
+    g_sockets.Install(g_nodeRoles.GetEndpoints());
     Ipv4AddressHelper address;
 
     for (uint32_t i = 0; i < nodes.GetN(); ++i) {
@@ -166,64 +376,190 @@ int main(int argc, char *argv[]) {
             link = pointToPoint.Install(NodeContainer(nodes.Get(i), nodes.Get(i + 1)));
         }
         devices.Add(link);
+        g_linkEvents.AddLink(link); // link i: node i <-> node i+1
+        g_linkMonitor.AddLink(link);
         std::ostringstream subnet;
         subnet << "10.1." << i + 1 << ".0";
         address.SetBase(subnet.str().c_str(), "255.255.255.0");
         address.Assign(link);
     }
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    g_routeCache.Populate("tcpcubic-Ring-" + std::to_string(nodes.GetN()));
+
+    if (!linkEvents.empty()) {
+        g_linkEvents.SetRecoveryCriterion(recoveryWindow, recoveryTolerance);
+        g_linkEvents.Schedule(linkEvents);
+    }
+
+    // Flow-hashed ECMP above global routing, which still handles local delivery
+    if (ecmp) {
+        EcmpRouting::Install(nodes, ecmpSlack);
+    }
 
     uint16_t serverPort = 9;
 
     Address sinkAddr(InetSocketAddress(Ipv4Address::GetAny(), serverPort));
-    PacketSinkHelper sinkHelper("ns3::TcpSocketFactory", sinkAddr);
-    ApplicationContainer sinkApp = sinkHelper.Install(nodes.Get(NUM_NODES - 1)); // Install on the last node
+    FlowSinkHelper sinkHelper("ns3::TcpSocketFactory", sinkAddr);
+    ApplicationContainer sinkApp = sinkHelper.Install(nodes.Get(serverNode)); // Install on the server node
     sinkApp.Start(Seconds(0.01));
     sinkApp.Stop(Seconds(DURATION));
-    sink = DynamicCast<PacketSink>(sinkApp.Get(0));
+    sink = DynamicCast<FlowSink>(sinkApp.Get(0));
+    g_sockets.Watch(sink);
+    g_rate.WatchNode(sink->GetNode());
 
-    // Get the IP address of the last node
-    Ptr<Ipv4> ipv4 = nodes.Get(NUM_NODES - 1)->GetObject<Ipv4>();
+    // Get the IP address of the server node
+    Ptr<Ipv4> ipv4 = nodes.Get(serverNode)->GetObject<Ipv4>();
     Ipv4Address destAddress = ipv4->GetAddress(1, 0).GetLocal();
 
-    // Set up BulkSendApplication as the traffic generator on the first node
-    BulkSendHelper sourceHelper("ns3::TcpSocketFactory", InetSocketAddress(destAddress, serverPort));
+    // Set up the bulk sender as the traffic generator on the first node
+    BulkSenderHelper sourceHelper(SocketRegistry::Protocol(), InetSocketAddress(destAddress, serverPort));
     sourceHelper.SetAttribute("MaxBytes", UintegerValue(0));  // Send unlimited data
     ApplicationContainer sourceApp = sourceHelper.Install(nodes.Get(0));
+    // Additional parallel flows; with ECMP they rotate over the server's addresses like the QUIC variant
+    for (uint32_t k = 1; k < flows; ++k) {
+        uint32_t serverInterface = ecmp ? 1 + k % (ipv4->GetNInterfaces() - 1) : 1;
+        sourceHelper.SetAttribute("Remote", AddressValue(InetSocketAddress(ipv4->GetAddress(serverInterface, 0).GetLocal(), serverPort)));
+        sourceApp.Add(sourceHelper.Install(nodes.Get(0)));
+    }
     sourceApp.Start(Seconds(0.0));
     sourceApp.Stop(Seconds(DURATION));
 
-    // Attach Cwnd and RTT tracers for the socket after the app starts
-    Simulator::Schedule(Seconds(0.1), &AttachSocketTraces, sourceApp.Get(0));
+    // Short request/response connections to the server next to the bulk flow (--churnRate)
+    if (churnRate > 0) {
+        g_churn.Configure("ns3::TcpSocketFactory", churnRate, churnRequest, churnResponse, false, g_metrics);
+        ApplicationContainer churnServer = g_churn.InstallServer(nodes.Get(serverNode));
+        churnServer.Start(Seconds(0.0));
+        churnServer.Stop(Seconds(DURATION));
+        ApplicationContainer churnClients = g_churn.InstallClient(nodes.Get(0), destAddress);
+        churnClients.Start(Seconds(1.0));
+        churnClients.Stop(Seconds(DURATION));
+    }
+
+    // --outputFormat=columnar replaces the four text series with one <prefix>.ncol file
+    if (outputFormat == "columnar") {
+        g_metrics.Open(g_replication.OutputPath(outputDir + "tcpcubic.ncol"), "tcpcubic", "Ring", DURATION, argc, argv);
+    }
 
     // Open the output files
-    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/";//CHANGE THIS 
-    cwndFile.open(outputDir + "tcpcubic.cwnd");
-    rttFile.open(outputDir + "tcpcubic.rtt");
-    throughputFile.open(outputDir + "tcpcubic.throughput");
-    packetLossFile.open(outputDir + "tcpcubic.packetloss");  // New file for packet loss logging
+    cwndFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.cwnd")));
+    rttFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.rtt")));
+    g_cwndBatch.SetOutput(cwndFile);
+    g_rttBatch.SetOutput(rttFile);
+    throughputFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.throughput")));
+    packetLossFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.packetloss")));  // New file for packet loss logging
     if (!cwndFile.is_open() || !rttFile.is_open() || !throughputFile.is_open() || !packetLossFile.is_open()) {
         std::cerr << "Error opening output files" << std::endl;
         return 1;
     }
 
+    // One columnar file for all link telemetry unless --linkStatsFormat=text
+    std::string linkStatsFile = outputDir + "tcpcubic.links" + (linkStatsFormat == "text" ? "" : ".ncol");
+    if (linkStatsPeriod > 0) {
+        g_linkMonitor.Start(Seconds(linkStatsPeriod), g_replication.OutputPath(linkStatsFile), linkStatsFormat != "text");
+    }
+
+    // IPFIX-like flow records of the packets reaching one node
+    std::string flowStatsFile = outputDir + "tcpcubic.flows";
+    if (flowStatsPeriod > 0) {
+        if (flowStatsNode >= static_cast<int32_t>(NodeList::GetNNodes())) {
+            std::cerr << "--flowStatsNode must be below " << NodeList::GetNNodes() << std::endl;
+            return 1;
+        }
+        Ptr<Node> flowNode = flowStatsNode >= 0 ? NodeList::GetNode(flowStatsNode) : nodes.Get(serverNode);
+        g_flowStats.Start(flowNode, Seconds(flowStatsPeriod), g_replication.OutputPath(flowStatsFile));
+    }
+
+    // CUBIC model state of every flow at its change points
+    std::string cubicFile = g_metrics.TextPath(outputDir + "tcpcubic.cubic");
+    if (cubicTrace) {
+        g_cubic.Start(g_replication.OutputPath(cubicFile));
+        g_sockets.AddHook(PROFILED(CubicTracer::Attach));
+    }
+
+    // Retransmission and recovery events of every flow
+    std::string recoveryFile = g_metrics.TextPath(outputDir + "tcpcubic.recovery");
+    if (g_recovery.IsEnabled()) {
+        g_recovery.Start(g_replication.OutputPath(recoveryFile));
+        g_sockets.AddHook(PROFILED(LossRecoveryStats::Attach));
+    }
+
+    // Per-hop delay decomposition and one-way delays, read by tags on the packets
+    if (hopLatency) {
+        g_hopLatency.Install();
+    }
+
+    // Handshake, time to first byte and completion of every short connection
+    std::string churnFile = g_metrics.TextPath(outputDir + "tcpcubic.churn");
+    if (g_churn.IsEnabled()) {
+        g_churn.Start(g_replication.OutputPath(churnFile));
+    }
+
+    // Every snapshot branch continues these series in its own files
+    g_snapshot.AddOutput(cwndFile, g_metrics.TextPath(outputDir + "tcpcubic.cwnd"));
+    g_snapshot.AddOutput(rttFile, g_metrics.TextPath(outputDir + "tcpcubic.rtt"));
+    g_snapshot.AddOutput(throughputFile, g_metrics.TextPath(outputDir + "tcpcubic.throughput"));
+    g_snapshot.AddOutput(packetLossFile, g_metrics.TextPath(outputDir + "tcpcubic.packetloss"));
+    if (linkStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_linkMonitor.GetSeriesStream(), linkStatsFile);
+    }
+    if (flowStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_flowStats.GetStream(), flowStatsFile);
+    }
+    if (g_cubic.IsEnabled()) {
+        g_snapshot.AddOutput(g_cubic.GetStream(), cubicFile);
+    }
+    if (g_recovery.IsEnabled()) {
+        g_snapshot.AddOutput(g_recovery.GetStream(), recoveryFile);
+    }
+    if (g_churn.IsEnabled()) {
+        g_snapshot.AddOutput(g_churn.GetStream(), churnFile);
+    }
+    if (g_metrics.IsEnabled()) {
+        g_snapshot.AddOutput(g_metrics.GetStream(), outputDir + "tcpcubic.ncol");
+    }
+    if (snapshotTime > 0) {
+        g_snapshot.Schedule(Seconds(snapshotTime), snapshotBranches);
+    }
+
     // Trace packet transmissions and receptions
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::PointToPointNetDevice/MacTx", MakeCallback(&PacketSent));
-    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::PointToPointNetDevice/MacRx", MakeCallback(&PacketReceived));
+    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::PointToPointNetDevice/MacTx", MakeCallback(PROFILED(PacketSent)));
+    Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::PointToPointNetDevice/MacRx", MakeCallback(PROFILED(PacketReceived)));
 
     // Schedule throughput and packet loss calculations
-    Simulator::Schedule(Seconds(0.01), &findThroughput);
-    Simulator::Schedule(Seconds(1.0), &CalculatePacketLoss);
+    Simulator::Schedule(Seconds(0.01), PROFILED(findThroughput));
+    Simulator::Schedule(Seconds(1.0), PROFILED(CalculatePacketLoss));
 
     Simulator::Stop(Seconds(DURATION));
-    Simulator::Run();
+    if (profile) {
+        g_profiler.Start();
+    }
+    g_schedulers.Run();
+    g_profiler.Stop();
+    g_cwndBatch.Flush();
+    g_rttBatch.Flush();
+
+    g_steadyState.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.steadystate")));
+    g_linkEvents.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.linkevents")));
+    g_linkMonitor.WriteHotspotReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.hotspots")));
+    g_profiler.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.profile")));
+    g_recovery.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.recoverystats")));
+    g_hopLatency.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.hops")));
+    g_hopLatency.WriteHistograms(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.hophist")));
+    g_churn.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.churnstats")));
+    g_nodeRoles.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.nodemem")));
+    g_snapshot.WaitForBranches();
 
     // Close the output files
     cwndFile.close();
     rttFile.close();
     throughputFile.close();
     packetLossFile.close();
+    g_linkMonitor.Close();
+    g_metrics.Close();
+    g_flowStats.Close();
+    g_cubic.Close();
+    g_recovery.Close();
+    g_churn.Close();
 
     std::cout << "Total Bytes Received from Server: " << sink->GetTotalRx() << std::endl;
 
@@ -42,52 +42,140 @@
 #include "ns3/internet-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
+#include "../common/steady-state-monitor.h"
+#include "../common/replication.h"
+#include "../common/snapshot-fork.h"
+#include "../common/link-events.h"
+#include "../common/link-monitor.h"
+#include "../common/metric-store.h"
+#include "../common/flow-aggregator.h"
+#include "../common/callback-profiler.h"
+#include "../common/scheduler-bench.h"
+#include "../common/flow-sink.h"
+#include "../common/rate-estimator.h"
+#include "../common/trace-batcher.h"
+#include "../common/socket-registry.h"
+#include "../common/cubic-tracer.h"
+#include "../common/loss-recovery.h"
+#include "../common/hop-latency.h"
+#include "../common/churn-workload.h"
+#include "../common/node-roles.h"
+#include "../common/bulk-sender.h"
 
 #define TCP_SEGMENT_SIZE 1500
 #define DATA_RATE_CLIENT_TO_ROUTER "15Mbps"
 #define DATA_RATE_ROUTER_TO_SERVER "15Mbps"
 #define DURATION 100.0
-#define NUM_NODES 8
+#define NUM_CLIENTS 6 // default of --clients
 
 using namespace ns3;
 
-Ptr<PacketSink> sink;
-uint64_t lastTotalRx = 0;
+Ptr<FlowSink> sink;
 uint32_t packetsSent = 0;
 uint32_t packetsReceived = 0;
 std::ofstream cwndFile, rttFile, throughputFile, packetLossFile;
 
+// Latest RTT sample in milliseconds, fed to the steady-state monitor
+double g_lastRtt = 0;
+
+// Optional early termination once throughput and RTT settle
+SteadyStateMonitor g_steadyState;
+
+// Multi-seed replication driver (--replications)
+ReplicationRunner g_replication;
+
+// Fork-based branching after the warm-up period (--snapshotTime)
+SnapshotBrancher g_snapshot;
+
+// Scheduled link rate/delay changes and failures (--linkEvents)
+LinkEventTimeline g_linkEvents;
+
+// Per-link utilization and queue sampling (--linkStatsPeriod)
+LinkMonitor g_linkMonitor;
+
+// Every sampled metric goes through here (replication, --outputFormat=columnar)
+MetricStore g_metrics(g_replication);
+
+// Per-flow counters at the router (--flowStatsPeriod)
+FlowAggregator g_flowStats;
+
+// Per-callback call counts and time (--profile)
+CallbackProfiler &g_profiler = CallbackProfiler::Instance();
+
+// Event scheduler choice and --schedulerBenchmark runs
+SchedulerBenchmark g_schedulers(g_replication);
+
+// Goodput and wire throughput per sampling interval (--throughputMode)
+RateEstimator g_rate;
+
+// Per-flow cwnd/RTT windows instead of one line per trace call (--traceBatch)
+TraceBatcher g_cwndBatch(g_metrics, METRIC_CWND);
+TraceBatcher g_rttBatch(g_metrics, METRIC_RTT);
+
+// Every TCP socket, traced from its creation or accept
+SocketRegistry g_sockets;
+
+// CUBIC W_max, K, epochs and slow-start exits per flow (--cubicTrace)
+CubicTracer &g_cubic = CubicTracer::Instance();
+
+// Retransmissions, timeouts and spurious recovery per flow (--recoveryStats)
+LossRecoveryStats &g_recovery = LossRecoveryStats::Instance();
+
+// Queue, serialization and propagation time per hop (--hopLatency)
+HopLatencyMonitor g_hopLatency;
+
+// Short connections measuring handshake and time to first byte (--churnRate)
+ChurnWorkload g_churn;
+
+// Endpoint and router stacks, stack memory per node (<prefix>.nodemem)
+NodeRoles g_nodeRoles;
+
 // Track packets sent
 void PacketSentCallback(Ptr<const Packet> packet) {
     packetsSent++;
 }
 
 // Track packets received
-void PacketReceivedCallback(Ptr<const Packet> packet, const Address &address) {
+void PacketReceivedCallback(uint32_t flow, uint32_t bytes) {
     packetsReceived++;
 }
 
 // Cwnd change function (in packets)
-static void CwndChange(uint32_t oldCwnd, uint32_t newCwnd) {
+static void CwndChange(uint32_t flow, uint32_t oldCwnd, uint32_t newCwnd) {
     double time = Simulator::Now().GetSeconds();
     double cwndInPackets = newCwnd / TCP_SEGMENT_SIZE;  // Convert to packets
+    if (g_cwndBatch.IsEnabled()) {
+        g_cwndBatch.Update(flow, time, cwndInPackets);
+        return;
+    }
     cwndFile << time << " " << cwndInPackets << std::endl;
+    g_metrics.Record(METRIC_CWND, time, cwndInPackets);
 }
 
 // RTT change function
-static void RttChange(Time oldRtt, Time newRtt) {
+static void RttChange(uint32_t flow, Time oldRtt, Time newRtt) {
     double time = Simulator::Now().GetSeconds();
+    g_lastRtt = newRtt.GetSeconds() * 1000;
+    if (g_rttBatch.IsEnabled()) {
+        g_rttBatch.Update(flow, time, newRtt.GetMilliSeconds());
+        return;
+    }
     rttFile << time << " " << newRtt.GetMilliSeconds() << std::endl;
+    g_metrics.Record(METRIC_RTT, time, newRtt.GetMilliSeconds());
 }
 
 // Throughput calculation function
 static void findThroughput() {
     Time currentTime = Simulator::Now();
     double time = currentTime.GetSeconds();
-    double currentThroughput = (sink->GetTotalRx() - lastTotalRx) * 8.0 / 1e6;  // Converted to Mbps
-    throughputFile << time << " " << currentThroughput << std::endl;
-    lastTotalRx = sink->GetTotalRx();
-    Simulator::Schedule(MilliSeconds(100), &findThroughput);
+    g_rate.Sample(sink->GetTotalRx());
+    double currentThroughput = g_rate.GetGoodput();  // Mbps over the time since the last sample
+    throughputFile << time << " " << currentThroughput << " " << g_rate.GetWireThroughput() << std::endl;
+    g_metrics.Record(METRIC_THROUGHPUT, time, currentThroughput);
+    g_metrics.RecordFlowThroughput(time, sink->GetFlows());
+    g_steadyState.AddSample(currentThroughput, g_lastRtt);
+    g_linkEvents.AddThroughputSample(currentThroughput);
+    Simulator::Schedule(MilliSeconds(100), PROFILED(findThroughput));
 }
 
 // Packet loss calculation function
@@ -96,26 +184,156 @@ static void CalculatePacketLoss() {
     if (packetsSent > 0) {
         double packetLossRate = ((packetsSent - packetsReceived) / static_cast<double>(packetsSent)) * 100;
         packetLossFile << time << " " << packetLossRate << std::endl;
+        g_metrics.Record(METRIC_PACKETLOSS, time, packetLossRate);
     } else {
         packetLossFile << time << " " << 0.0 << std::endl;
+        g_metrics.Record(METRIC_PACKETLOSS, time, 0.0);
     }
-    Simulator::Schedule(MilliSeconds(100), &CalculatePacketLoss);
+    Simulator::Schedule(MilliSeconds(100), PROFILED(CalculatePacketLoss));
 }
 
-static void TraceCwnd() {
-    Config::ConnectWithoutContext("/NodeList/*/$ns3::TcpL4Protocol/SocketList/*/CongestionWindow", MakeCallback(&CwndChange));
+// Hook cwnd and RTT of every TCP socket when it is created or accepted
+static void AttachSocketTraces(uint32_t flow, Ptr<TcpSocketBase> socket) {
+    socket->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback(PROFILED(CwndChange), flow));
+    socket->TraceConnectWithoutContext("RTT", MakeBoundCallback(PROFILED(RttChange), flow));
 }
 
-static void TraceRtt() {
-    Config::ConnectWithoutContext("/NodeList/*/$ns3::TcpL4Protocol/SocketList/*/RTT", MakeCallback(&RttChange));
-}
+int main(int argc, char *argv[]) {
+    uint32_t numClients = NUM_CLIENTS;
+    bool steadyState = false;
+    double steadyWindow = 10.0;
+    double steadyTolerance = 0.05;
+    double steadyMinTime = 10.0;
+    uint32_t replications = 1;
+    double ciBinWidth = 1.0;
+    double snapshotTime = 0.0;
+    std::string snapshotBranches = "";
+    std::string linkEvents = "";
+    double recoveryWindow = 5.0;
+    double recoveryTolerance = 0.1;
+    double linkStatsPeriod = 0.0;
+    std::string linkStatsFormat = "columnar";
+    std::string outputFormat = "text";
+    double flowStatsPeriod = 0.0;
+    int32_t flowStatsNode = -1;
+    bool profile = false;
+    std::string scheduler = "map";
+    std::string schedulerBenchmark = "";
+    std::string traceBatch = "off";
+    std::string throughputMode = "window";
+    bool cubicTrace = false;
+    bool recoveryStats = false;
+    bool hopLatency = false;
+    double churnRate = 0.0;
+    uint32_t churnRequest = 100;
+    uint32_t churnResponse = 1000;
+    bool fullStacks = false;
+    std::string sender = "virtual";
+    bool senderBenchmark = false;
+
+    CommandLine cmd;
+    cmd.AddValue("clients", "Number of clients, all served by one listening sink on the server", numClients);
+    cmd.AddValue("steadyState", "Stop the run once throughput and RTT are stable", steadyState);
+    cmd.AddValue("steadyWindow", "Steady-state detection window in seconds", steadyWindow);
+    cmd.AddValue("steadyTolerance", "Maximum coefficient of variation considered stable", steadyTolerance);
+    cmd.AddValue("steadyMinTime", "Earliest time in seconds at which the run may stop", steadyMinTime);
+    cmd.AddValue("replications", "Number of independent replications (RngRun, RngRun+1, ...)", replications);
+    cmd.AddValue("ciBinWidth", "Time bin in seconds for the replication confidence intervals", ciBinWidth);
+    cmd.AddValue("snapshotTime", "Warm-up time in seconds after which the run forks into branches", snapshotTime);
+    cmd.AddValue("snapshotBranches", "Per-branch Config paths to change, e.g. \"path=value,...;path=value\"", snapshotBranches);
+    cmd.AddValue("linkEvents", "Link event timeline, e.g. \"10s:rate:1:2Mbps;30s:down:0;40s:up:0\"", linkEvents);
+    cmd.AddValue("recoveryWindow", "Window in seconds used to detect throughput re-convergence", recoveryWindow);
+    cmd.AddValue("recoveryTolerance", "Coefficient of variation at which throughput counts as re-converged", recoveryTolerance);
+    cmd.AddValue("linkStatsPeriod", "Per-link utilization/queue sampling period in seconds (0 = off)", linkStatsPeriod);
+    cmd.AddValue("linkStatsFormat", "Link statistics file format: columnar or text", linkStatsFormat);
+    cmd.AddValue("outputFormat", "Metric output format: text (one file per metric) or columnar (one .ncol file)", outputFormat);
+    cmd.AddValue("flowStatsPeriod", "Per-flow summary export period in seconds (0 = off)", flowStatsPeriod);
+    cmd.AddValue("flowStatsNode", "Node whose received flows are aggregated (-1 = the router)", flowStatsNode);
+    cmd.AddValue("profile", "Time every scenario callback and write tcpcubic.profile", profile);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar or priorityqueue", scheduler);
+    cmd.AddValue("schedulerBenchmark", "Run once per scheduler (\"all\" or e.g. \"map,heap\") and report events/s", schedulerBenchmark);
+    cmd.AddValue("traceBatch", "cwnd/RTT output per flow and window: off, rtt or a window in seconds", traceBatch);
+    cmd.AddValue("throughputMode", "Throughput estimate: window (per sampling interval) or ewma:<seconds>", throughputMode);
+    cmd.AddValue("cubicTrace", "Write CUBIC W_max, K, epoch and slow-start exits per flow to tcpcubic.cubic", cubicTrace);
+    cmd.AddValue("recoveryStats", "Write retransmission and loss-recovery events and totals per flow", recoveryStats);
+    cmd.AddValue("hopLatency", "Per-hop delay histograms and one-way delay per node pair (tcpcubic.hops)", hopLatency);
+    cmd.AddValue("churnRate", "Short connections per second from every client (0 = off)", churnRate);
+    cmd.AddValue("churnRequest", "Request size in bytes of a short connection", churnRequest);
+    cmd.AddValue("churnResponse", "Response size in bytes of a short connection", churnResponse);
+    cmd.AddValue("fullStacks", "Install the full internet stack on routers too", fullStacks);
+    cmd.AddValue("sender", "Bulk sender: virtual (shared payload, batched writes) or bulk (BulkSendApplication)", sender);
+    cmd.AddValue("senderBenchmark", "Run once with each bulk sender and report events/s and peak RSS", senderBenchmark);
+    cmd.Parse(argc, argv);
+
+    if (steadyState) {
+        g_steadyState.Enable(steadyWindow, steadyTolerance, steadyMinTime);
+    }
+
+    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/"; //CHANGE THIS
+
+    if (snapshotTime > 0 && replications > 1) {
+        std::cerr << "--snapshotTime cannot be combined with --replications" << std::endl;
+        return 1;
+    }
+
+    if ((!schedulerBenchmark.empty() || senderBenchmark) && (replications > 1 || snapshotTime > 0)) {
+        std::cerr << "--schedulerBenchmark and --senderBenchmark cannot be combined with --replications or --snapshotTime"
+                  << std::endl;
+        return 1;
+    }
+
+    if (!schedulerBenchmark.empty() && senderBenchmark) {
+        std::cerr << "--schedulerBenchmark cannot be combined with --senderBenchmark" << std::endl;
+        return 1;
+    }
+
+    // Each replication runs in a child process; the parent only aggregates their samples
+    if (replications > 1 && g_replication.Fork(replications, ciBinWidth) < 0) {
+        g_replication.WriteConfidenceIntervals(outputDir + "tcpcubic");
+        return 0;
+    }
+
+    // Same scenario once per scheduler, each in a child process; the parent only reports events/s
+    if (!schedulerBenchmark.empty() &&
+        g_schedulers.Fork(schedulerBenchmark, scheduler, outputDir + "tcpcubic.schedulers") < 0) {
+        return 0;
+    }
+
+    // Same scenario once per bulk sender, each in a child process; the parent reports events/s and RSS
+    if (senderBenchmark &&
+        g_schedulers.ForkEach("sender", {"bulk", "virtual"}, sender, outputDir + "tcpcubic.senders") < 0) {
+        return 0;
+    }
+    if (!BulkSenderHelper::Use(sender)) {
+        return 1;
+    }
+    if (!SchedulerBenchmark::Apply(scheduler)) {
+        return 1;
+    }
+    // Client i uses subnet 10.(1 + (i + 1) / 256).((i + 1) % 256).0/24
+    if (numClients == 0 || numClients > 65000) {
+        std::cerr << "--clients must be between 1 and 65000" << std::endl;
+        return 1;
+    }
+    if (!g_rate.Configure(throughputMode)) {
+        return 1;
+    }
+    if (!g_cwndBatch.Configure(traceBatch, &g_rttBatch) || !g_rttBatch.Configure(traceBatch, &g_rttBatch)) {
+        return 1;
+    }
+    if (recoveryStats) {
+        g_recovery.Configure(g_metrics);
+    }
+    if (cubicTrace) {
+        g_cubic.Configure(g_metrics);
+    }
 
-int main() {
     int tcpSegmentSize = TCP_SEGMENT_SIZE; // Set your desired segment size
     Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(tcpSegmentSize));
     Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(2));
     Config::SetDefault("ns3::TcpL4Protocol::SocketType", StringValue("ns3::TcpCubic"));
 
+    const uint32_t NUM_NODES = numClients + 2; // clients + 1 Router + 1 Server
     NodeContainer nodes;
     nodes.Create(NUM_NODES);
 
@@ -134,78 +352,206 @@ int main() {
     pointToPointRouterToServer.SetDeviceAttribute("DataRate", StringValue(DATA_RATE_ROUTER_TO_SERVER));
     pointToPointRouterToServer.SetChannelAttribute("Delay", StringValue("3ms"));
 
-    InternetStackHelper stack;
-    stack.Install(nodes);
+    // Full stack on the endpoints, IPv4 forwarding only on the routers unless --fullStacks
+    NodeContainer endpoints = clients;
+    endpoints.Add(server);
+    g_nodeRoles.Install(nodes, fullStacks ? nodes : endpoints);
+    g_sockets.AddHook(PROFILED(AttachSocketTraces));
+    g_sockets.Install(g_nodeRoles.GetEndpoints());
 
     Ipv4AddressHelper address;
     NetDeviceContainer devices;
     Ipv4InterfaceContainer interfaces;
 
+    // Every leaf has a default route to the router, which reaches all leaf subnets directly. That
+    // replaces the global route computation, whose tables grow with the square of the client count.
+    Ipv4StaticRoutingHelper staticRouting;
     for (uint32_t i = 0; i < clients.GetN(); ++i) {
         devices = pointToPointClientToRouter.Install(clients.Get(i), router);
-        std::string subnet = "10.1." + std::to_string(i + 1) + ".0";
+        g_linkEvents.AddLink(devices); // link i: client i <-> router
+        g_linkMonitor.AddLink(devices);
+        std::string subnet = "10." + std::to_string(1 + (i + 1) / 256) + "." + std::to_string((i + 1) % 256) + ".0";
         address.SetBase(Ipv4Address(subnet.c_str()), "255.255.255.0");
         interfaces = address.Assign(devices);
+        staticRouting.GetStaticRouting(clients.Get(i)->GetObject<Ipv4>())->SetDefaultRoute(interfaces.GetAddress(1), 1);
     }
 
     devices = pointToPointRouterToServer.Install(router, server);
+    g_linkEvents.AddLink(devices); // last link: router <-> server
+    g_linkMonitor.AddLink(devices);
     address.SetBase(Ipv4Address("10.1.0.0"), "255.255.255.0");
     interfaces = address.Assign(devices);
+    staticRouting.GetStaticRouting(server->GetObject<Ipv4>())->SetDefaultRoute(interfaces.GetAddress(0), 1);
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    if (!linkEvents.empty()) {
+        g_linkEvents.SetRecoveryCriterion(recoveryWindow, recoveryTolerance);
+        // Static default routes do not change with links; global routing would rebuild tables for every node
+        g_linkEvents.SetRecomputeCallback([] {});
+        g_linkEvents.Schedule(linkEvents);
+    }
 
     uint16_t serverPort = 9;
 
     Address sinkAddr(InetSocketAddress(Ipv4Address::GetAny(), serverPort));
-    PacketSinkHelper sinkHelper("ns3::TcpSocketFactory", sinkAddr);
+    FlowSinkHelper sinkHelper("ns3::TcpSocketFactory", sinkAddr);
     ApplicationContainer sinkApp = sinkHelper.Install(server);
     sinkApp.Start(Seconds(0.01));
     sinkApp.Stop(Seconds(DURATION));
-    sink = DynamicCast<PacketSink>(sinkApp.Get(0));
+    sink = DynamicCast<FlowSink>(sinkApp.Get(0));
+    g_sockets.Watch(sink);
+    g_rate.WatchNode(sink->GetNode());
 
     for (uint32_t i = 0; i < clients.GetN(); ++i) {
         Ptr<Socket> ns3TcpSocket = Socket::CreateSocket(clients.Get(i), TcpSocketFactory::GetTypeId());
         ns3TcpSocket->SetAttribute("InitialCwnd", UintegerValue(10)); // Set initial congestion window
 
-        // Using BulkSendHelper instead of OnOffHelper
-        BulkSendHelper sourceHelper("ns3::TcpSocketFactory", InetSocketAddress(interfaces.GetAddress(1), serverPort));
+        // Using BulkSenderHelper instead of OnOffHelper
+        BulkSenderHelper sourceHelper(SocketRegistry::Protocol(), InetSocketAddress(interfaces.GetAddress(1), serverPort));
         sourceHelper.SetAttribute("MaxBytes", UintegerValue(0)); // Send unlimited data
         ApplicationContainer sourceApp = sourceHelper.Install(clients.Get(i));
         sourceApp.Start(Seconds(0.0));
         sourceApp.Stop(Seconds(DURATION));
     }
 
+    // Short request/response connections to the server next to the bulk flow (--churnRate)
+    if (churnRate > 0) {
+        g_churn.Configure("ns3::TcpSocketFactory", churnRate, churnRequest, churnResponse, false, g_metrics);
+        ApplicationContainer churnServer = g_churn.InstallServer(server);
+        churnServer.Start(Seconds(0.0));
+        churnServer.Stop(Seconds(DURATION));
+        ApplicationContainer churnClients = g_churn.InstallClients(clients, interfaces.GetAddress(1));
+        churnClients.Start(Seconds(1.0));
+        churnClients.Stop(Seconds(DURATION));
+    }
+
+    // --outputFormat=columnar replaces the four text series with one <prefix>.ncol file
+    if (outputFormat == "columnar") {
+        g_metrics.Open(g_replication.OutputPath(outputDir + "tcpcubic.ncol"), "tcpcubic", "Star", DURATION, argc, argv);
+    }
+
     // Open the output files
-    std::string outputDir = "/path/to/sourcens3/folder/desired/output/file/"; //CHANGE THIS
-    cwndFile.open(outputDir + "tcpcubic.cwnd");
-    rttFile.open(outputDir + "tcpcubic.rtt");
-    throughputFile.open(outputDir + "tcpcubic.throughput");
-    packetLossFile.open(outputDir + "tcpcubic.packetloss");
+    cwndFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.cwnd")));
+    rttFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.rtt")));
+    g_cwndBatch.SetOutput(cwndFile);
+    g_rttBatch.SetOutput(rttFile);
+    throughputFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.throughput")));
+    packetLossFile.open(g_metrics.TextPath(g_replication.OutputPath(outputDir + "tcpcubic.packetloss")));
     if (!cwndFile.is_open() || !rttFile.is_open() || !throughputFile.is_open() || !packetLossFile.is_open()) {
         std::cerr << "Error opening output files" << std::endl;
         return 1;
     }
 
+    // One columnar file for all link telemetry unless --linkStatsFormat=text
+    std::string linkStatsFile = outputDir + "tcpcubic.links" + (linkStatsFormat == "text" ? "" : ".ncol");
+    if (linkStatsPeriod > 0) {
+        g_linkMonitor.Start(Seconds(linkStatsPeriod), g_replication.OutputPath(linkStatsFile), linkStatsFormat != "text");
+    }
+
+    // IPFIX-like flow records of the packets reaching one node
+    std::string flowStatsFile = outputDir + "tcpcubic.flows";
+    if (flowStatsPeriod > 0) {
+        if (flowStatsNode >= static_cast<int32_t>(NodeList::GetNNodes())) {
+            std::cerr << "--flowStatsNode must be below " << NodeList::GetNNodes() << std::endl;
+            return 1;
+        }
+        Ptr<Node> flowNode = flowStatsNode >= 0 ? NodeList::GetNode(flowStatsNode) : router;
+        g_flowStats.Start(flowNode, Seconds(flowStatsPeriod), g_replication.OutputPath(flowStatsFile));
+    }
+
+    // CUBIC model state of every flow at its change points
+    std::string cubicFile = g_metrics.TextPath(outputDir + "tcpcubic.cubic");
+    if (cubicTrace) {
+        g_cubic.Start(g_replication.OutputPath(cubicFile));
+        g_sockets.AddHook(PROFILED(CubicTracer::Attach));
+    }
+
+    // Retransmission and recovery events of every flow
+    std::string recoveryFile = g_metrics.TextPath(outputDir + "tcpcubic.recovery");
+    if (g_recovery.IsEnabled()) {
+        g_recovery.Start(g_replication.OutputPath(recoveryFile));
+        g_sockets.AddHook(PROFILED(LossRecoveryStats::Attach));
+    }
+
+    // Per-hop delay decomposition and one-way delays, read by tags on the packets
+    if (hopLatency) {
+        g_hopLatency.Install();
+    }
+
+    // Handshake, time to first byte and completion of every short connection
+    std::string churnFile = g_metrics.TextPath(outputDir + "tcpcubic.churn");
+    if (g_churn.IsEnabled()) {
+        g_churn.Start(g_replication.OutputPath(churnFile));
+    }
+
+    // Every snapshot branch continues these series in its own files
+    g_snapshot.AddOutput(cwndFile, g_metrics.TextPath(outputDir + "tcpcubic.cwnd"));
+    g_snapshot.AddOutput(rttFile, g_metrics.TextPath(outputDir + "tcpcubic.rtt"));
+    g_snapshot.AddOutput(throughputFile, g_metrics.TextPath(outputDir + "tcpcubic.throughput"));
+    g_snapshot.AddOutput(packetLossFile, g_metrics.TextPath(outputDir + "tcpcubic.packetloss"));
+    if (linkStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_linkMonitor.GetSeriesStream(), linkStatsFile);
+    }
+    if (flowStatsPeriod > 0) {
+        g_snapshot.AddOutput(g_flowStats.GetStream(), flowStatsFile);
+    }
+    if (g_cubic.IsEnabled()) {
+        g_snapshot.AddOutput(g_cubic.GetStream(), cubicFile);
+    }
+    if (g_recovery.IsEnabled()) {
+        g_snapshot.AddOutput(g_recovery.GetStream(), recoveryFile);
+    }
+    if (g_churn.IsEnabled()) {
+        g_snapshot.AddOutput(g_churn.GetStream(), churnFile);
+    }
+    if (g_metrics.IsEnabled()) {
+        g_snapshot.AddOutput(g_metrics.GetStream(), outputDir + "tcpcubic.ncol");
+    }
+    if (snapshotTime > 0) {
+        g_snapshot.Schedule(Seconds(snapshotTime), snapshotBranches);
+    }
+
     // Schedule tracing functions
-    Simulator::Schedule(Seconds(0.01), &TraceCwnd);
-    Simulator::Schedule(Seconds(0.01), &TraceRtt);
-    Simulator::Schedule(Seconds(1.0), &findThroughput);
-    Simulator::Schedule(Seconds(1.0), &CalculatePacketLoss);
+    Simulator::Schedule(Seconds(1.0), PROFILED(findThroughput));
+    Simulator::Schedule(Seconds(1.0), PROFILED(CalculatePacketLoss));
 
     // Connect callbacks for packet tracking
     for (uint32_t i = 0; i < clients.GetN(); ++i) {
-        clients.Get(i)->GetApplication(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+        clients.Get(i)->GetApplication(0)->TraceConnectWithoutContext("Tx", MakeCallback(PROFILED(PacketSentCallback)));
     }
-    sinkApp.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PacketReceivedCallback));
+    sinkApp.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(PROFILED(PacketReceivedCallback)));
 
     Simulator::Stop(Seconds(DURATION));
-    Simulator::Run();
+    if (profile) {
+        g_profiler.Start();
+    }
+    g_schedulers.Run();
+    g_profiler.Stop();
+    g_cwndBatch.Flush();
+    g_rttBatch.Flush();
+
+    g_steadyState.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.steadystate")));
+    g_linkEvents.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.linkevents")));
+    g_linkMonitor.WriteHotspotReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.hotspots")));
+    g_profiler.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.profile")));
+    g_recovery.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.recoverystats")));
+    g_hopLatency.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.hops")));
+    g_hopLatency.WriteHistograms(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.hophist")));
+    g_churn.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.churnstats")));
+    sink->WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.sinkflows")));
+    g_nodeRoles.WriteReport(g_snapshot.BranchPath(g_replication.OutputPath(outputDir + "tcpcubic.nodemem")));
+    g_snapshot.WaitForBranches();
 
     // Close the output files
     cwndFile.close();
     rttFile.close();
     throughputFile.close();
     packetLossFile.close();
+    g_linkMonitor.Close();
+    g_metrics.Close();
+    g_flowStats.Close();
+    g_cubic.Close();
+    g_recovery.Close();
+    g_churn.Close();
 
     std::cout << "Total Bytes Received from Server: " << sink->GetTotalRx() << std::endl;
 
@@ -0,0 +1,326 @@
+/*
+===================================================================
+    BBR State Tracer
+===================================================================
+
+    Samples the internal state of every QUIC BBR controller, which
+    the cwnd/RTT traces of QuicSocketBase do not show:
+
+      state         STARTUP, DRAIN, PROBE_BW or PROBE_RTT
+      btlBwMbps     bottleneck bandwidth estimate: the maximum
+                    delivery rate of the last 10 round trips (BBR's
+                    BtlBw filter; app-limited samples only count when
+                    they raise it)
+      rtPropMs      minimum RTT of the last 10 s (BBR's RTprop
+                    filter), so PROBE_RTT refreshes show
+      pacingRate    current pacing rate (Mbps); capped by
+                    TcpSocketState::MaxPacingRate (--pacingRate)
+      pacingGain    gain applied to BtlBw for the pacing rate
+      cwndGain      gain applied to the BDP for cwnd
+      cwndPackets   congestion window in segments
+
+    With --bbrTracePeriod the programs install TracedQuicBbr instead
+    of QuicBbr as the QUIC socket type. It is the same controller; it
+    only registers itself here and keeps the socket state it is
+    given on every ACK, and runs its own BtlBw and RTprop filters
+    over the rate samples and RTTs of those ACKs, since QuicBbr keeps
+    its estimates private. The pacing rate cannot stand in for them:
+    it is clamped to MaxPacingRate and carries the pacing gain and
+    margin. Every period, each flow that has seen an ACK
+    writes one tab-separated row to <prefix>.bbr, and to a "bbr"
+    series of the columnar file when --outputFormat=columnar:
+
+      # time flow state btlBwMbps rtPropMs pacingRateMbps pacingGain
+        cwndGain cwndPackets
+
+    The same controller feeds the QUIC side of loss-recovery.h
+    (--recoveryStats), so it is installed when either is enabled.
+
+    Flow ids count controllers in creation order (one per socket;
+    server-side sockets never see ACKs for data and stay silent).
+    State transitions are resolved to the sampling period.
+    WriteReport() summarizes per flow the time spent in each state,
+    the number of transitions and the number of PROBE_RTT entries.
+
+===================================================================
+*/
+
+#ifndef BBR_TRACER_H
+#define BBR_TRACER_H
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <utility>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/quic-bbr.h"
+#include "loss-recovery.h"
+#include "metric-store.h"
+
+class TracedQuicBbr;
+
+class BbrTracer {
+public:
+    static constexpr uint32_t STATES = 4;
+    static constexpr uint32_t PROBE_RTT = 3;
+
+    static BbrTracer &Instance() {
+        static BbrTracer tracer;
+        return tracer;
+    }
+
+    static const char *StateName(uint32_t state) {
+        static const char *names[STATES] = {"STARTUP", "DRAIN", "PROBE_BW", "PROBE_RTT"};
+        return state < STATES ? names[state] : "unknown";
+    }
+
+    bool IsEnabled() const {
+        return !m_period.IsZero();
+    }
+
+    // Sample every `period`; declares the columnar series, so call before MetricStore::Open()
+    void Configure(ns3::Time period, MetricStore &metrics) {
+        m_period = period;
+        m_metrics = &metrics;
+        m_series = metrics.AddSeries("bbr", {"flow", "state", "btlBwMbps", "rtPropMs", "pacingRateMbps",
+                                             "pacingGain", "cwndGain", "cwndPackets"});
+    }
+
+    // Open the text output and schedule the first sample
+    void Start(const std::string &path) {
+        m_stream.open(path);
+        m_stream << "# time\tflow\tstate\tbtlBwMbps\trtPropMs\tpacingRateMbps\tpacingGain\tcwndGain\tcwndPackets"
+                 << std::endl;
+        ns3::Simulator::Schedule(m_period, &BbrTracer::Sample, this);
+    }
+
+    std::ofstream &GetStream() {
+        return m_stream;
+    }
+
+    // Flow id for a new controller
+    uint32_t Add(TracedQuicBbr *bbr) {
+        m_flows.push_back(Flow{bbr, STATES, 0.0, {0.0, 0.0, 0.0, 0.0}, 0, 0});
+        return static_cast<uint32_t>(m_flows.size() - 1);
+    }
+
+    void Remove(uint32_t flow) {
+        m_flows[flow].bbr = nullptr;
+    }
+
+    // Per flow: seconds in each state, transitions and PROBE_RTT entries
+    void WriteReport(const std::string &path) {
+        if (!IsEnabled()) {
+            return;
+        }
+        double now = ns3::Simulator::Now().GetSeconds();
+        std::ofstream report(path);
+        report << "# flow\tstartupS\tdrainS\tprobeBwS\tprobeRttS\ttransitions\tprobeRttEntries\tfinalState"
+               << std::endl;
+        for (uint32_t i = 0; i < m_flows.size(); ++i) {
+            const Flow &flow = m_flows[i];
+            if (flow.state == STATES) {
+                continue;
+            }
+            report << i;
+            for (uint32_t state = 0; state < STATES; ++state) {
+                report << "\t" << flow.stateTime[state] + (state == flow.state ? now - flow.since : 0.0);
+            }
+            report << "\t" << flow.transitions << "\t" << flow.probeRttEntries << "\t" << StateName(flow.state)
+                   << std::endl;
+        }
+    }
+
+    void Close() {
+        if (m_stream.is_open()) {
+            m_stream.close();
+        }
+    }
+
+private:
+    struct Flow {
+        TracedQuicBbr *bbr;
+        uint32_t state; // STATES until the first sample
+        double since;
+        double stateTime[STATES];
+        uint32_t transitions;
+        uint32_t probeRttEntries;
+    };
+
+    BbrTracer() = default;
+
+    void Sample();
+
+    ns3::Time m_period;
+    MetricStore *m_metrics = nullptr;
+    uint32_t m_series = 0;
+    std::ofstream m_stream;
+    std::vector<Flow> m_flows;
+};
+
+// QuicBbr that reports its state to BbrTracer
+class TracedQuicBbr : public ns3::QuicBbr {
+public:
+    static constexpr uint64_t BTLBW_ROUNDS = 10; // BtlBw filter length in round trips
+    static constexpr double RTPROP_WINDOW = 10.0; // RTprop filter length in seconds
+
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid = ns3::TypeId("ns3::TracedQuicBbr")
+                                     .SetParent<ns3::QuicBbr>()
+                                     .SetGroupName("Internet")
+                                     .AddConstructor<TracedQuicBbr>();
+        return tid;
+    }
+
+    TracedQuicBbr() : m_flow(BbrTracer::Instance().Add(this)) {}
+
+    TracedQuicBbr(const TracedQuicBbr &other) : ns3::QuicBbr(other), m_flow(BbrTracer::Instance().Add(this)) {}
+
+    ~TracedQuicBbr() override {
+        BbrTracer::Instance().Remove(m_flow);
+    }
+
+    std::string GetName() const override {
+        return "TracedQuicBbr";
+    }
+
+    ns3::Ptr<ns3::TcpCongestionOps> Fork() override {
+        return ns3::CopyObject<TracedQuicBbr>(this);
+    }
+
+    void PktsAcked(ns3::Ptr<ns3::TcpSocketState> tcb, uint32_t segmentsAcked, const ns3::Time &rtt) override {
+        m_tcb = tcb;
+        if (rtt.GetNanoSeconds() > 0) {
+            AddRtt(ns3::Simulator::Now().GetSeconds(), rtt.GetSeconds());
+        }
+        if (LossRecoveryStats::Instance().IsEnabled()) {
+            LossRecoveryStats::Instance().AddSent(m_flow, static_cast<uint64_t>(segmentsAcked) * tcb->m_segmentSize);
+        }
+        ns3::QuicBbr::PktsAcked(tcb, segmentsAcked, rtt);
+    }
+
+    void CongControl(ns3::Ptr<ns3::TcpSocketState> tcb, const ns3::TcpRateOps::TcpRateConnection &rc,
+                     const ns3::TcpRateOps::TcpRateSample &rs) override {
+        m_tcb = tcb;
+        // A round trip ends when a packet sent after the previous round's end is delivered
+        if (static_cast<uint64_t>(rs.m_priorDelivered) >= m_nextRoundDelivered) {
+            m_nextRoundDelivered = rc.m_delivered;
+            m_round++;
+        }
+        AddDeliveryRate(rs.m_deliveryRate.GetBitRate() / 1e6, rs.m_isAppLimited);
+        ns3::QuicBbr::CongControl(tcb, rc, rs);
+    }
+
+    void OnPacketsLost(ns3::Ptr<ns3::TcpSocketState> tcb,
+                       std::vector<ns3::Ptr<ns3::QuicSocketTxItem>> lostPackets) override {
+        LossRecoveryStats &stats = LossRecoveryStats::Instance();
+        if (stats.IsEnabled()) {
+            for (const ns3::Ptr<ns3::QuicSocketTxItem> &item : lostPackets) {
+                stats.AddSent(m_flow, item->m_packet->GetSize());
+                stats.Record(m_flow, LossRecoveryStats::LOST, item->m_packet->GetSize());
+            }
+        }
+        ns3::QuicBbr::OnPacketsLost(tcb, lostPackets);
+    }
+
+    void OnRetransmissionTimeout(ns3::Ptr<ns3::TcpSocketState> tcb) override {
+        if (LossRecoveryStats::Instance().IsEnabled()) {
+            LossRecoveryStats::Instance().Record(m_flow, LossRecoveryStats::PTO, 0);
+        }
+        ns3::QuicBbr::OnRetransmissionTimeout(tcb);
+    }
+
+    void OnRetransmissionTimeoutVerified(ns3::Ptr<ns3::TcpSocketState> tcb) override {
+        if (LossRecoveryStats::Instance().IsEnabled()) {
+            LossRecoveryStats::Instance().Record(m_flow, LossRecoveryStats::PTO_VERIFIED, 0);
+        }
+        ns3::QuicBbr::OnRetransmissionTimeoutVerified(tcb);
+    }
+
+    // Socket state of the last ACK, null before the first one
+    ns3::Ptr<ns3::TcpSocketState> GetTcb() const {
+        return m_tcb;
+    }
+
+    // Windowed maximum delivery rate (Mbps), 0 before the first rate sample
+    double GetBtlBw() const {
+        return m_btlBw.empty() ? 0.0 : m_btlBw.front().second;
+    }
+
+    // Windowed minimum RTT (ms), 0 before the first RTT sample
+    double GetRtProp() const {
+        return m_rtProp.empty() ? 0.0 : m_rtProp.front().second * 1000;
+    }
+
+private:
+    // Monotonic deques: the front is the filter's value, later entries the candidates once it expires
+    void AddDeliveryRate(double mbps, bool appLimited) {
+        if (mbps <= 0 || (appLimited && mbps < GetBtlBw())) {
+            return;
+        }
+        while (!m_btlBw.empty() && m_btlBw.back().second <= mbps) {
+            m_btlBw.pop_back();
+        }
+        m_btlBw.emplace_back(m_round, mbps);
+        while (m_btlBw.front().first + BTLBW_ROUNDS <= m_round) {
+            m_btlBw.pop_front();
+        }
+    }
+
+    void AddRtt(double now, double rtt) {
+        while (!m_rtProp.empty() && m_rtProp.back().second >= rtt) {
+            m_rtProp.pop_back();
+        }
+        m_rtProp.emplace_back(now, rtt);
+        while (m_rtProp.front().first + RTPROP_WINDOW < now) {
+            m_rtProp.pop_front();
+        }
+    }
+
+    uint32_t m_flow;
+    ns3::Ptr<ns3::TcpSocketState> m_tcb;
+    uint64_t m_round = 0;
+    uint64_t m_nextRoundDelivered = 0;
+    std::deque<std::pair<uint64_t, double>> m_btlBw; // (round, Mbps)
+    std::deque<std::pair<double, double>> m_rtProp;  // (time s, RTT s)
+};
+
+inline void BbrTracer::Sample() {
+    double now = ns3::Simulator::Now().GetSeconds();
+    for (uint32_t i = 0; i < m_flows.size(); ++i) {
+        Flow &flow = m_flows[i];
+        if (flow.bbr == nullptr || !flow.bbr->GetTcb()) {
+            continue;
+        }
+        ns3::Ptr<ns3::TcpSocketState> tcb = flow.bbr->GetTcb();
+        uint32_t state = static_cast<uint32_t>(flow.bbr->GetBbrState());
+        if (state != flow.state) {
+            if (flow.state < STATES) {
+                flow.stateTime[flow.state] += now - flow.since;
+                flow.transitions++;
+            }
+            if (state == PROBE_RTT) {
+                flow.probeRttEntries++;
+            }
+            flow.state = state;
+            flow.since = now;
+        }
+        double pacingGain = flow.bbr->GetPacingGain();
+        double cwndGain = flow.bbr->GetCwndGain();
+        double pacingRate = tcb->m_pacingRate.Get().GetBitRate() / 1e6;
+        double btlBw = flow.bbr->GetBtlBw();
+        double rtProp = flow.bbr->GetRtProp();
+        double cwnd = static_cast<double>(tcb->m_cWnd.Get()) / tcb->m_segmentSize;
+        m_stream << now << "\t" << i << "\t" << StateName(state) << "\t" << btlBw << "\t" << rtProp << "\t"
+                 << pacingRate << "\t" << pacingGain << "\t" << cwndGain << "\t" << cwnd << "\n";
+        m_metrics->RecordRow(m_series, now, {static_cast<double>(i), static_cast<double>(state), btlBw, rtProp,
+                                             pacingRate, pacingGain, cwndGain, cwnd});
+    }
+    m_stream.flush();
+    ns3::Simulator::Schedule(m_period, &BbrTracer::Sample, this);
+}
+
+#endif // BBR_TRACER_H
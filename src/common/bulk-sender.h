@@ -0,0 +1,252 @@
+/*
+===================================================================
+    Virtual-Payload Bulk Sender
+===================================================================
+
+    BulkSendApplication writes SendSize bytes (512 by default) per
+    Send() call, each one a new Packet, until the socket refuses, and
+    does it again on every send callback. At high rates and with many
+    flows, most of the work in its events goes into creating these
+    packets and into the socket's per-call processing.
+
+    VirtualBulkSend has the same attributes (Protocol, Remote,
+    SendSize, MaxBytes) and the same "Tx" trace. It differs in two
+    ways:
+
+      payload  one zero-filled template packet per application; every
+               write is a Copy() or CreateFragment() of it, which
+               shares the template's buffer, so no payload buffer is
+               allocated or filled per write
+      batch    each write takes all the room the socket has
+               (GetTxAvailable), rounded down to whole SendSize
+               chunks, so one Send() refills the TX buffer
+
+    "Tx" still fires once per SendSize chunk handed to the socket,
+    always with the same chunk packet, so packet counters built on it
+    match BulkSendApplication's.
+
+    BulkSenderHelper is a drop-in for BulkSendHelper. It installs
+    VirtualBulkSend or BulkSendApplication, whichever Use() picked
+    (--sender=virtual|bulk). GetSocket() works with both.
+    --senderBenchmark runs the scenario once with each and writes
+    events/s and peak RSS to <prefix>.senders (scheduler-bench.h).
+
+===================================================================
+*/
+
+#ifndef BULK_SENDER_H
+#define BULK_SENDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+
+class VirtualBulkSend : public ns3::Application {
+public:
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid =
+            ns3::TypeId("ns3::VirtualBulkSend")
+                .SetParent<ns3::Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<VirtualBulkSend>()
+                .AddAttribute("SendSize", "Bytes per chunk; writes are whole chunks", ns3::UintegerValue(512),
+                              ns3::MakeUintegerAccessor(&VirtualBulkSend::m_sendSize),
+                              ns3::MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("Remote", "The address of the destination", ns3::AddressValue(),
+                              ns3::MakeAddressAccessor(&VirtualBulkSend::m_peer), ns3::MakeAddressChecker())
+                .AddAttribute("MaxBytes", "Total bytes to send (0 = no limit)", ns3::UintegerValue(0),
+                              ns3::MakeUintegerAccessor(&VirtualBulkSend::m_maxBytes),
+                              ns3::MakeUintegerChecker<uint64_t>())
+                .AddAttribute("Protocol", "The socket factory to use", ns3::TypeIdValue(ns3::TcpSocketFactory::GetTypeId()),
+                              ns3::MakeTypeIdAccessor(&VirtualBulkSend::m_tid), ns3::MakeTypeIdChecker())
+                .AddAttribute("Batch", "Fill the free TX buffer with one write instead of one chunk per write",
+                              ns3::BooleanValue(true), ns3::MakeBooleanAccessor(&VirtualBulkSend::m_batch),
+                              ns3::MakeBooleanChecker())
+                .AddTraceSource("Tx", "A chunk handed to the socket",
+                                ns3::MakeTraceSourceAccessor(&VirtualBulkSend::m_txTrace),
+                                "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    ns3::Ptr<ns3::Socket> GetSocket() const {
+        return m_socket;
+    }
+
+    uint64_t GetTotalTx() const {
+        return m_totBytes;
+    }
+
+protected:
+    void DoDispose() override {
+        m_socket = nullptr;
+        m_payload = nullptr;
+        m_chunk = nullptr;
+        ns3::Application::DoDispose();
+    }
+
+private:
+    void StartApplication() override {
+        if (!m_socket) {
+            m_socket = ns3::Socket::CreateSocket(GetNode(), m_tid);
+            if (m_socket->Bind() == -1) {
+                std::cerr << "VirtualBulkSend: failed to bind the socket" << std::endl;
+                exit(1);
+            }
+            m_socket->Connect(m_peer);
+            m_socket->ShutdownRecv();
+            m_socket->SetConnectCallback(ns3::MakeCallback(&VirtualBulkSend::ConnectionSucceeded, this),
+                                         ns3::MakeCallback(&VirtualBulkSend::ConnectionFailed, this));
+            m_socket->SetSendCallback(ns3::MakeCallback(&VirtualBulkSend::DataSend, this));
+            m_chunk = ns3::Create<ns3::Packet>(m_sendSize);
+        }
+        if (m_connected) {
+            SendData();
+        }
+    }
+
+    void StopApplication() override {
+        if (m_socket) {
+            m_socket->Close();
+            m_connected = false;
+        }
+    }
+
+    void SendData() {
+        while (m_maxBytes == 0 || m_totBytes < m_maxBytes) {
+            uint64_t toSend = m_sendSize;
+            if (m_batch) {
+                uint32_t room = m_socket->GetTxAvailable();
+                toSend = std::max<uint64_t>(m_sendSize, room - room % m_sendSize);
+            }
+            if (m_maxBytes > 0) {
+                toSend = std::min(toSend, m_maxBytes - m_totBytes);
+            }
+            int actual = m_socket->Send(Payload(static_cast<uint32_t>(toSend)));
+            if (actual <= 0) {
+                break; // TX buffer full; DataSend() resumes
+            }
+            m_totBytes += actual;
+            NotifyTx(static_cast<uint32_t>(actual));
+            if (static_cast<uint64_t>(actual) < toSend) {
+                break;
+            }
+        }
+        if (m_maxBytes != 0 && m_totBytes == m_maxBytes && m_connected) {
+            m_socket->Close();
+            m_connected = false;
+        }
+    }
+
+    // `bytes` of the zero-filled template, sharing its buffer
+    ns3::Ptr<ns3::Packet> Payload(uint32_t bytes) {
+        if (!m_payload || m_payload->GetSize() < bytes) {
+            m_payload = ns3::Create<ns3::Packet>(bytes);
+        }
+        return bytes == m_payload->GetSize() ? m_payload->Copy() : m_payload->CreateFragment(0, bytes);
+    }
+
+    void NotifyTx(uint32_t bytes) {
+        for (uint32_t i = 0; i < bytes / m_sendSize; ++i) {
+            m_txTrace(m_chunk);
+        }
+        if (bytes % m_sendSize != 0) {
+            m_txTrace(m_payload->CreateFragment(0, bytes % m_sendSize));
+        }
+    }
+
+    void ConnectionSucceeded(ns3::Ptr<ns3::Socket>) {
+        m_connected = true;
+        SendData();
+    }
+
+    void ConnectionFailed(ns3::Ptr<ns3::Socket>) {
+        std::cerr << "VirtualBulkSend: connection failed" << std::endl;
+    }
+
+    void DataSend(ns3::Ptr<ns3::Socket>, uint32_t) {
+        if (m_connected) {
+            SendData();
+        }
+    }
+
+    ns3::Ptr<ns3::Socket> m_socket;
+    ns3::Address m_peer;
+    ns3::TypeId m_tid;
+    uint32_t m_sendSize = 512;
+    uint64_t m_maxBytes = 0;
+    bool m_batch = true;
+    bool m_connected = false;
+    uint64_t m_totBytes = 0;
+    ns3::Ptr<ns3::Packet> m_payload;
+    ns3::Ptr<ns3::Packet> m_chunk;
+    ns3::TracedCallback<ns3::Ptr<const ns3::Packet>> m_txTrace;
+};
+
+// Same interface as BulkSendHelper; installs the sender chosen with Use()
+class BulkSenderHelper {
+public:
+    BulkSenderHelper(const std::string &protocol, const ns3::Address &remote) {
+        m_factory.SetTypeId(Virtual() ? VirtualBulkSend::GetTypeId() : ns3::BulkSendApplication::GetTypeId());
+        m_factory.Set("Protocol", ns3::StringValue(protocol));
+        m_factory.Set("Remote", ns3::AddressValue(remote));
+    }
+
+    // --sender: "virtual" (VirtualBulkSend, the default) or "bulk" (BulkSendApplication)
+    static bool Use(const std::string &name) {
+        if (name != "virtual" && name != "bulk") {
+            std::cerr << "Unknown --sender " << name << " (virtual, bulk)" << std::endl;
+            return false;
+        }
+        Virtual() = name == "virtual";
+        return true;
+    }
+
+    // Socket of either sender; null before it starts or for other applications
+    static ns3::Ptr<ns3::Socket> GetSocket(ns3::Ptr<ns3::Application> app) {
+        if (ns3::Ptr<VirtualBulkSend> sender = ns3::DynamicCast<VirtualBulkSend>(app)) {
+            return sender->GetSocket();
+        }
+        if (ns3::Ptr<ns3::BulkSendApplication> sender = ns3::DynamicCast<ns3::BulkSendApplication>(app)) {
+            return sender->GetSocket();
+        }
+        return nullptr;
+    }
+
+    static bool IsSender(ns3::Ptr<ns3::Application> app) {
+        return ns3::DynamicCast<VirtualBulkSend>(app) || ns3::DynamicCast<ns3::BulkSendApplication>(app);
+    }
+
+    void SetAttribute(const std::string &name, const ns3::AttributeValue &value) {
+        m_factory.Set(name, value);
+    }
+
+    ns3::ApplicationContainer Install(ns3::Ptr<ns3::Node> node) const {
+        ns3::Ptr<ns3::Application> app = m_factory.Create<ns3::Application>();
+        node->AddApplication(app);
+        return ns3::ApplicationContainer(app);
+    }
+
+    ns3::ApplicationContainer Install(const ns3::NodeContainer &nodes) const {
+        ns3::ApplicationContainer apps;
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            apps.Add(Install(nodes.Get(i)));
+        }
+        return apps;
+    }
+
+private:
+    static bool &Virtual() {
+        static bool useVirtual = true;
+        return useVirtual;
+    }
+
+    ns3::ObjectFactory m_factory;
+};
+
+#endif // BULK_SENDER_H
@@ -0,0 +1,485 @@
+/*
+===================================================================
+    Connection-Churn Workload
+===================================================================
+
+    Many short request/response connections next to the long-lived
+    bulk flow, so that connection setup shows up in the results:
+
+      ChurnClient   opens a new connection to the server at Poisson
+                    arrivals (--churnRate per second and client),
+                    sends a --churnRequest byte request once connected
+                    (right after Connect() with --churnZeroRtt) and
+                    closes after --churnResponse bytes came back
+      ChurnServer   answers every request of --churnRequest bytes
+                    with --churnResponse bytes
+
+    Per connection, measured at the client from the Connect() call:
+
+      handshake     until the connection-succeeded callback
+      ttfb          until the first response byte
+      completion    until the last response byte
+
+    Completed connections are written to <prefix>.churn:
+
+      # time client handshakeMs ttfbMs completionMs
+
+    ("-" when the socket never reported the handshake), and to a
+    "churn" series of the columnar file (handshakeMs -1 there).
+    WriteReport()
+    gives per client and in total the connections opened, completed
+    and failed and the mean/p50/p90/p99 of each measure, from
+    LatencyHistogram (hop-latency.h).
+
+    QUIC: --churnZeroRtt sets ns3::QuicSocketBase::0RTT-Handshake so
+    the request goes out with the first flight. Every connection is a
+    new QUIC socket; the module keeps no session tickets, so 0-RTT
+    stands in for resumption.
+
+===================================================================
+*/
+
+#ifndef CHURN_WORKLOAD_H
+#define CHURN_WORKLOAD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "hop-latency.h"
+#include "metric-store.h"
+
+class ChurnWorkload;
+
+class ChurnServer : public ns3::Application {
+public:
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid = ns3::TypeId("ns3::ChurnServer")
+                                     .SetParent<ns3::Application>()
+                                     .SetGroupName("Applications")
+                                     .AddConstructor<ChurnServer>();
+        return tid;
+    }
+
+    void Setup(const std::string &protocol, const ns3::Address &local, uint32_t request, uint32_t response) {
+        m_protocol = ns3::TypeId::LookupByName(protocol);
+        m_local = local;
+        m_requestSize = request;
+        m_responseSize = response;
+    }
+
+protected:
+    void DoDispose() override {
+        m_socket = nullptr;
+        m_connections.clear();
+        ns3::Application::DoDispose();
+    }
+
+private:
+    struct Connection {
+        ns3::Ptr<ns3::Socket> socket;
+        uint64_t received = 0;
+        uint32_t toSend = 0;
+        bool answered = false;
+    };
+
+    void StartApplication() override {
+        if (!m_socket) {
+            m_socket = ns3::Socket::CreateSocket(GetNode(), m_protocol);
+            if (m_socket->Bind(m_local) == -1) {
+                std::cerr << "ChurnServer: failed to bind the listening socket" << std::endl;
+                exit(1);
+            }
+            m_socket->Listen();
+        }
+        m_socket->SetAcceptCallback(ns3::MakeNullCallback<bool, ns3::Ptr<ns3::Socket>, const ns3::Address &>(),
+                                    ns3::MakeCallback(&ChurnServer::HandleAccept, this));
+    }
+
+    void StopApplication() override {
+        for (auto &entry : m_connections) {
+            entry.second.socket->Close();
+        }
+        m_connections.clear();
+        if (m_socket) {
+            m_socket->Close();
+        }
+    }
+
+    void HandleAccept(ns3::Ptr<ns3::Socket> socket, const ns3::Address &) {
+        m_connections[ns3::PeekPointer(socket)].socket = socket;
+        socket->SetRecvCallback(ns3::MakeCallback(&ChurnServer::HandleRead, this));
+        socket->SetSendCallback(ns3::MakeCallback(&ChurnServer::HandleSend, this));
+        socket->SetCloseCallbacks(ns3::MakeCallback(&ChurnServer::HandleClose, this),
+                                  ns3::MakeCallback(&ChurnServer::HandleClose, this));
+    }
+
+    void HandleRead(ns3::Ptr<ns3::Socket> socket) {
+        auto found = m_connections.find(ns3::PeekPointer(socket));
+        ns3::Ptr<ns3::Packet> packet;
+        while ((packet = socket->Recv())) {
+            if (packet->GetSize() == 0) {
+                break;
+            }
+            if (found != m_connections.end()) {
+                found->second.received += packet->GetSize();
+            }
+        }
+        if (found != m_connections.end() && !found->second.answered && found->second.received >= m_requestSize) {
+            found->second.answered = true;
+            found->second.toSend = m_responseSize;
+            HandleSend(socket, socket->GetTxAvailable());
+        }
+    }
+
+    void HandleSend(ns3::Ptr<ns3::Socket> socket, uint32_t) {
+        auto found = m_connections.find(ns3::PeekPointer(socket));
+        if (found == m_connections.end()) {
+            return;
+        }
+        Connection &connection = found->second;
+        while (connection.toSend > 0) {
+            uint32_t chunk = std::min(connection.toSend, socket->GetTxAvailable());
+            if (chunk == 0 || socket->Send(ns3::Create<ns3::Packet>(chunk)) < 0) {
+                return; // resumed by the send callback
+            }
+            connection.toSend -= chunk;
+        }
+    }
+
+    void HandleClose(ns3::Ptr<ns3::Socket> socket) {
+        m_connections.erase(ns3::PeekPointer(socket));
+    }
+
+    ns3::TypeId m_protocol;
+    ns3::Address m_local;
+    uint32_t m_requestSize = 0;
+    uint32_t m_responseSize = 0;
+    ns3::Ptr<ns3::Socket> m_socket;
+    std::unordered_map<const ns3::Socket *, Connection> m_connections;
+};
+
+class ChurnClient : public ns3::Application {
+public:
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid = ns3::TypeId("ns3::ChurnClient")
+                                     .SetParent<ns3::Application>()
+                                     .SetGroupName("Applications")
+                                     .AddConstructor<ChurnClient>();
+        return tid;
+    }
+
+    void Setup(ChurnWorkload *workload, uint32_t id, const std::string &protocol, const ns3::Address &remote,
+               double rate, uint32_t request, uint32_t response, bool zeroRtt) {
+        m_workload = workload;
+        m_id = id;
+        m_protocol = ns3::TypeId::LookupByName(protocol);
+        m_remote = remote;
+        m_interval = ns3::CreateObject<ns3::ExponentialRandomVariable>();
+        m_interval->SetAttribute("Mean", ns3::DoubleValue(1.0 / rate));
+        m_requestSize = request;
+        m_responseSize = response;
+        m_zeroRtt = zeroRtt;
+    }
+
+protected:
+    void DoDispose() override {
+        m_open.clear();
+        ns3::Application::DoDispose();
+    }
+
+private:
+    struct Connection {
+        ns3::Ptr<ns3::Socket> socket;
+        double start = 0.0;
+        double established = -1.0;
+        double firstByte = -1.0;
+        uint64_t received = 0;
+        bool requested = false;
+    };
+
+    void StartApplication() override {
+        m_next = ns3::Simulator::Schedule(ns3::Seconds(m_interval->GetValue()), &ChurnClient::Open, this);
+    }
+
+    void StopApplication() override;
+
+    void Open();
+
+    void Request(Connection &connection) {
+        if (!connection.requested) {
+            connection.requested = true;
+            connection.socket->Send(ns3::Create<ns3::Packet>(m_requestSize));
+        }
+    }
+
+    static void HandleConnected(ChurnClient *client, uint32_t id, ns3::Ptr<ns3::Socket>) {
+        auto found = client->m_open.find(id);
+        if (found == client->m_open.end()) {
+            return;
+        }
+        found->second.established = ns3::Simulator::Now().GetSeconds();
+        client->Request(found->second);
+    }
+
+    static void HandleFailed(ChurnClient *client, uint32_t id, ns3::Ptr<ns3::Socket>) {
+        client->Fail(id);
+    }
+
+    static void HandleRead(ChurnClient *client, uint32_t id, ns3::Ptr<ns3::Socket> socket);
+
+    void Fail(uint32_t id);
+
+    ChurnWorkload *m_workload = nullptr;
+    uint32_t m_id = 0;
+    ns3::TypeId m_protocol;
+    ns3::Address m_remote;
+    ns3::Ptr<ns3::ExponentialRandomVariable> m_interval;
+    uint32_t m_requestSize = 0;
+    uint32_t m_responseSize = 0;
+    bool m_zeroRtt = false;
+    ns3::EventId m_next;
+    uint32_t m_nextId = 0;
+    std::unordered_map<uint32_t, Connection> m_open;
+};
+
+class ChurnWorkload {
+public:
+    static constexpr uint16_t PORT = 9100;
+
+    // Socket factory of both ends, connections per second and client, request/response sizes.
+    // Declares the columnar series, so call before MetricStore::Open()
+    void Configure(const std::string &protocol, double rate, uint32_t request, uint32_t response, bool zeroRtt,
+                   MetricStore &metrics) {
+        m_metrics = &metrics;
+        m_series = metrics.AddSeries("churn", {"client", "handshakeMs", "ttfbMs", "completionMs"});
+        m_protocol = protocol;
+        m_rate = rate;
+        m_requestSize = std::max<uint32_t>(1, request);
+        m_responseSize = std::max<uint32_t>(1, response);
+        m_zeroRtt = zeroRtt;
+    }
+
+    bool IsEnabled() const {
+        return m_rate > 0;
+    }
+
+    // Let QUIC clients send the request with the first flight
+    static bool EnableZeroRtt() {
+        if (!ns3::Config::SetDefaultFailSafe("ns3::QuicSocketBase::0RTT-Handshake", ns3::BooleanValue(true))) {
+            std::cerr << "--churnZeroRtt: this QUIC module has no 0RTT-Handshake attribute" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    ns3::ApplicationContainer InstallServer(ns3::Ptr<ns3::Node> node) {
+        ns3::Ptr<ChurnServer> server = ns3::CreateObject<ChurnServer>();
+        server->Setup(m_protocol, ns3::InetSocketAddress(ns3::Ipv4Address::GetAny(), PORT), m_requestSize,
+                      m_responseSize);
+        node->AddApplication(server);
+        return ns3::ApplicationContainer(server);
+    }
+
+    ns3::ApplicationContainer InstallClient(ns3::Ptr<ns3::Node> node, ns3::Ipv4Address server) {
+        uint32_t id = static_cast<uint32_t>(m_clients.size());
+        m_clients.push_back(ClientStats());
+        m_clients[id].node = node->GetId();
+        ns3::Ptr<ChurnClient> client = ns3::CreateObject<ChurnClient>();
+        client->Setup(this, id, m_protocol, ns3::InetSocketAddress(server, PORT), m_rate, m_requestSize,
+                      m_responseSize, m_zeroRtt);
+        node->AddApplication(client);
+        return ns3::ApplicationContainer(client);
+    }
+
+    ns3::ApplicationContainer InstallClients(const ns3::NodeContainer &nodes, ns3::Ipv4Address server) {
+        ns3::ApplicationContainer apps;
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            apps.Add(InstallClient(nodes.Get(i), server));
+        }
+        return apps;
+    }
+
+    void Start(const std::string &path) {
+        m_stream.open(path);
+        m_stream << "# time\tclient\thandshakeMs\tttfbMs\tcompletionMs" << std::endl;
+    }
+
+    std::ofstream &GetStream() {
+        return m_stream;
+    }
+
+    void Opened(uint32_t client) {
+        m_clients[client].opened++;
+    }
+
+    void Completed(uint32_t client, double handshake, double ttfb, double completion) {
+        ClientStats &stats = m_clients[client];
+        if (handshake >= 0) {
+            stats.measures[HANDSHAKE].Add(handshake);
+        }
+        stats.measures[TTFB].Add(ttfb);
+        stats.measures[COMPLETION].Add(completion);
+        m_stream << ns3::Simulator::Now().GetSeconds() << "\t" << client << "\t";
+        if (handshake >= 0) {
+            m_stream << handshake * 1000;
+        } else {
+            m_stream << "-";
+        }
+        m_stream << "\t" << ttfb * 1000 << "\t" << completion * 1000 << "\n";
+        m_metrics->RecordRow(m_series, ns3::Simulator::Now().GetSeconds(),
+                             {static_cast<double>(client), handshake >= 0 ? handshake * 1000 : -1.0, ttfb * 1000,
+                              completion * 1000});
+    }
+
+    void Failed(uint32_t client) {
+        m_clients[client].failed++;
+    }
+
+    // Per client and in total: opened, completed, failed and the distribution of each measure (ms)
+    void WriteReport(const std::string &path) const {
+        if (!IsEnabled()) {
+            return;
+        }
+        std::ofstream report(path);
+        report << "# " << m_protocol << ", " << m_rate << " connections/s per client, request " << m_requestSize
+               << " B, response " << m_responseSize << " B" << (m_zeroRtt ? ", 0-RTT" : "") << std::endl;
+        report << "# client\tnode\topened\tcompleted\tfailed";
+        for (uint32_t measure = 0; measure < MEASURES; ++measure) {
+            for (const char *stat : {"Mean", "P50", "P90", "P99"}) {
+                report << "\t" << MeasureName(measure) << stat << "Ms";
+            }
+        }
+        report << std::endl;
+        ClientStats total;
+        for (uint32_t i = 0; i < m_clients.size(); ++i) {
+            WriteRow(report, std::to_string(i), std::to_string(m_clients[i].node), m_clients[i]);
+            total.opened += m_clients[i].opened;
+            total.failed += m_clients[i].failed;
+            for (uint32_t measure = 0; measure < MEASURES; ++measure) {
+                total.measures[measure].Merge(m_clients[i].measures[measure]);
+            }
+        }
+        WriteRow(report, "all", "-", total);
+    }
+
+    void Close() {
+        if (m_stream.is_open()) {
+            m_stream.close();
+        }
+    }
+
+private:
+    enum Measure { HANDSHAKE, TTFB, COMPLETION, MEASURES };
+
+    struct ClientStats {
+        uint32_t node = 0;
+        uint64_t opened = 0;
+        uint64_t failed = 0;
+        LatencyHistogram measures[MEASURES];
+    };
+
+    static const char *MeasureName(uint32_t measure) {
+        static const char *names[MEASURES] = {"handshake", "ttfb", "completion"};
+        return names[measure];
+    }
+
+    static void WriteRow(std::ofstream &report, const std::string &client, const std::string &node,
+                         const ClientStats &stats) {
+        report << client << "\t" << node << "\t" << stats.opened << "\t" << stats.measures[COMPLETION].GetCount()
+               << "\t" << stats.failed;
+        for (uint32_t measure = 0; measure < MEASURES; ++measure) {
+            const LatencyHistogram &histogram = stats.measures[measure];
+            report << "\t" << histogram.MeanMs() << "\t" << histogram.QuantileMs(0.5) << "\t"
+                   << histogram.QuantileMs(0.9) << "\t" << histogram.QuantileMs(0.99);
+        }
+        report << std::endl;
+    }
+
+    std::string m_protocol;
+    double m_rate = 0.0;
+    uint32_t m_requestSize = 1;
+    uint32_t m_responseSize = 1;
+    bool m_zeroRtt = false;
+    MetricStore *m_metrics = nullptr;
+    uint32_t m_series = 0;
+    std::vector<ClientStats> m_clients;
+    std::ofstream m_stream;
+};
+
+inline void ChurnClient::Open() {
+    uint32_t id = m_nextId++;
+    Connection &connection = m_open[id];
+    connection.start = ns3::Simulator::Now().GetSeconds();
+    connection.socket = ns3::Socket::CreateSocket(GetNode(), m_protocol);
+    connection.socket->Bind();
+    connection.socket->SetConnectCallback(ns3::MakeBoundCallback(&ChurnClient::HandleConnected, this, id),
+                                          ns3::MakeBoundCallback(&ChurnClient::HandleFailed, this, id));
+    connection.socket->SetRecvCallback(ns3::MakeBoundCallback(&ChurnClient::HandleRead, this, id));
+    connection.socket->SetCloseCallbacks(ns3::MakeNullCallback<void, ns3::Ptr<ns3::Socket>>(),
+                                         ns3::MakeBoundCallback(&ChurnClient::HandleFailed, this, id));
+    m_workload->Opened(m_id);
+    connection.socket->Connect(m_remote);
+    if (m_zeroRtt) {
+        Request(connection);
+    }
+    m_next = ns3::Simulator::Schedule(ns3::Seconds(m_interval->GetValue()), &ChurnClient::Open, this);
+}
+
+inline void ChurnClient::HandleRead(ChurnClient *client, uint32_t id, ns3::Ptr<ns3::Socket> socket) {
+    auto found = client->m_open.find(id);
+    ns3::Ptr<ns3::Packet> packet;
+    while ((packet = socket->Recv())) {
+        if (packet->GetSize() == 0 || found == client->m_open.end()) {
+            break;
+        }
+        Connection &connection = found->second;
+        double now = ns3::Simulator::Now().GetSeconds();
+        if (connection.firstByte < 0) {
+            connection.firstByte = now;
+        }
+        connection.received += packet->GetSize();
+        if (connection.received >= client->m_responseSize) {
+            double handshake = connection.established >= 0 ? connection.established - connection.start : -1.0;
+            client->m_workload->Completed(client->m_id, handshake, connection.firstByte - connection.start,
+                                          now - connection.start);
+            connection.socket->SetRecvCallback(ns3::MakeNullCallback<void, ns3::Ptr<ns3::Socket>>());
+            connection.socket->SetCloseCallbacks(ns3::MakeNullCallback<void, ns3::Ptr<ns3::Socket>>(),
+                                                 ns3::MakeNullCallback<void, ns3::Ptr<ns3::Socket>>());
+            connection.socket->Close();
+            client->m_open.erase(found);
+            return;
+        }
+    }
+}
+
+inline void ChurnClient::Fail(uint32_t id) {
+    auto found = m_open.find(id);
+    if (found == m_open.end()) {
+        return;
+    }
+    m_workload->Failed(m_id);
+    found->second.socket->Close();
+    m_open.erase(found);
+}
+
+inline void ChurnClient::StopApplication() {
+    ns3::Simulator::Cancel(m_next);
+    for (auto &entry : m_open) {
+        entry.second.socket->SetCloseCallbacks(ns3::MakeNullCallback<void, ns3::Ptr<ns3::Socket>>(),
+                                               ns3::MakeNullCallback<void, ns3::Ptr<ns3::Socket>>());
+        entry.second.socket->Close();
+    }
+    // Connections still open at the end are neither completed nor failed
+    m_open.clear();
+}
+
+#endif // CHURN_WORKLOAD_H
@@ -0,0 +1,416 @@
+/*
+===================================================================
+    Columnar Telemetry Reader
+===================================================================
+
+    Lazy reader for files written by columnar-writer.h. The file is
+    memory-mapped; Open() only parses the header and the block index,
+    and a column is decoded when it is requested, and only from the
+    blocks whose [tMin, tMax] range overlaps the requested time
+    window. Pages of other blocks and columns are never touched, so
+    multi-GB traces open instantly and use memory in proportion to
+    the window that is read.
+
+    Files without an index (a run that was killed before Close())
+    are indexed by walking the block headers once.
+
+    Usage:
+    ------------------------
+    ColumnarReader reader;
+    reader.Open("quicbbr.ncol");
+    int32_t series = reader.FindSeries("throughput");
+    std::vector<double> time = reader.ReadColumn(series, "time", 10.0, 20.0);
+    std::vector<double> mbps = reader.ReadColumn(series, "value", 10.0, 20.0);
+
+    // Streaming, one block at a time
+    reader.Scan(series, {reader.FindColumn(series, "value")}, 10.0, 20.0,
+                [](const std::vector<std::vector<double>> &columns, std::size_t row) { ... });
+
+===================================================================
+*/
+
+#ifndef COLUMNAR_READER_H
+#define COLUMNAR_READER_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "columnar-writer.h"
+
+namespace columnar {
+
+inline uint64_t GetVarint(const char *&data, const char *end) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (data < end) {
+        uint8_t byte = static_cast<uint8_t>(*data++);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            break;
+        }
+        shift += 7;
+    }
+    return value;
+}
+
+inline int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Decode `rows` values of one encoded column into doubles (integers are converted)
+inline void Decode(ColumnType type, const char *data, std::size_t length, uint32_t rows, std::vector<double> &out) {
+    const char *end = data + length;
+    if (type == COLUMN_TIME) {
+        int64_t previous = 0;
+        int64_t previousDelta = 0;
+        for (uint32_t i = 0; i < rows; ++i) {
+            int64_t v = UnZigZag(GetVarint(data, end));
+            int64_t ns = i == 0 ? v : previous + previousDelta + v;
+            previousDelta = i == 0 ? 0 : ns - previous;
+            previous = ns;
+            out.push_back(ns / 1e9);
+        }
+    } else if (type == COLUMN_F64) {
+        uint64_t previous = 0;
+        for (uint32_t i = 0; i < rows && data < end; ++i) {
+            uint8_t control = static_cast<uint8_t>(*data++);
+            uint64_t x = 0;
+            int trailing = control >> 4;
+            int significant = control & 0x0f;
+            for (int b = 0; b < significant && data < end; ++b) {
+                x |= static_cast<uint64_t>(static_cast<uint8_t>(*data++)) << (8 * (trailing + b));
+            }
+            previous ^= x;
+            double value;
+            std::memcpy(&value, &previous, sizeof(value));
+            out.push_back(value);
+        }
+    } else {
+        int64_t previous = 0;
+        for (uint32_t i = 0; i < rows; ++i) {
+            previous += UnZigZag(GetVarint(data, end));
+            out.push_back(static_cast<double>(previous));
+        }
+    }
+}
+
+inline uint32_t LoadU32(const char *data) {
+    uint32_t value = 0;
+    for (int b = 0; b < 4; ++b) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data[b])) << (8 * b);
+    }
+    return value;
+}
+
+inline uint64_t LoadU64(const char *data) {
+    uint64_t value = 0;
+    for (int b = 0; b < 8; ++b) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[b])) << (8 * b);
+    }
+    return value;
+}
+
+inline double LoadF64(const char *data) {
+    uint64_t bits = LoadU64(data);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace columnar
+
+class ColumnarReader {
+public:
+    struct ColumnInfo {
+        std::string name;
+        ColumnType type;
+    };
+
+    struct SeriesInfo {
+        std::string name;
+        std::vector<ColumnInfo> columns;
+    };
+
+    struct BlockInfo {
+        uint64_t offset;
+        uint32_t series;
+        uint32_t rows;
+        double tMin;
+        double tMax;
+    };
+
+    ColumnarReader() = default;
+    ColumnarReader(const ColumnarReader &) = delete;
+    ColumnarReader &operator=(const ColumnarReader &) = delete;
+
+    ~ColumnarReader() {
+        if (m_data != nullptr) {
+            munmap(const_cast<char *>(m_data), m_size);
+        }
+    }
+
+    bool Open(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            std::cerr << "Columnar: cannot open " << path << std::endl;
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+        m_size = static_cast<uint64_t>(info.st_size);
+        void *data = m_size >= 9 ? mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (data == MAP_FAILED || std::memcmp(data, "NCOL", 4) != 0) {
+            std::cerr << "Columnar: " << path << " is not a columnar file" << std::endl;
+            if (data != MAP_FAILED) {
+                munmap(data, m_size);
+            }
+            return false;
+        }
+        m_data = static_cast<const char *>(data);
+        if (static_cast<uint8_t>(m_data[4]) != ColumnarWriter::VERSION) {
+            std::cerr << "Columnar: " << path << " has unsupported version " << static_cast<int>(m_data[4]) << std::endl;
+            return false;
+        }
+        uint32_t headerLength = columnar::LoadU32(m_data + 5);
+        if (9 + static_cast<uint64_t>(headerLength) > m_size) {
+            std::cerr << "Columnar: " << path << " has a truncated header" << std::endl;
+            return false;
+        }
+        ParseHeader(std::string(m_data + 9, headerLength));
+        m_dataStart = 9 + headerLength;
+        // Blocks are visited in file order but only partly; let the kernel skip read-ahead
+        madvise(data, m_size, MADV_RANDOM);
+        if (!ReadIndex()) {
+            ScanBlocks();
+        }
+        return true;
+    }
+
+    const std::vector<SeriesInfo> &GetSeries() const {
+        return m_series;
+    }
+
+    const std::vector<BlockInfo> &GetBlocks() const {
+        return m_blocks;
+    }
+
+    // Header attribute (run configuration), or `fallback` if absent
+    std::string GetAttribute(const std::string &key, const std::string &fallback = "") const {
+        auto it = m_attributes.find(key);
+        return it == m_attributes.end() ? fallback : it->second;
+    }
+
+    const std::map<std::string, std::string> &GetAttributes() const {
+        return m_attributes;
+    }
+
+    int32_t FindSeries(const std::string &name) const {
+        for (uint32_t i = 0; i < m_series.size(); ++i) {
+            if (m_series[i].name == name) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    int32_t FindColumn(int32_t series, const std::string &name) const {
+        if (series < 0 || static_cast<uint32_t>(series) >= m_series.size()) {
+            return -1;
+        }
+        const std::vector<ColumnInfo> &columns = m_series[series].columns;
+        for (uint32_t i = 0; i < columns.size(); ++i) {
+            if (columns[i].name == name) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    // Decode `columns` block by block and call visit(values, row) for every row with
+    // tStart <= time <= tEnd; values[k] holds the block's decoded columns[k]
+    template <typename Visitor>
+    void Scan(int32_t series, const std::vector<int32_t> &columns, double tStart, double tEnd, Visitor visit) const {
+        if (series < 0 || static_cast<uint32_t>(series) >= m_series.size()) {
+            return;
+        }
+        int32_t timeColumn = TimeColumn(series);
+        bool bounded = timeColumn >= 0 && (tStart > -std::numeric_limits<double>::infinity() ||
+                                           tEnd < std::numeric_limits<double>::infinity());
+        std::vector<std::vector<double>> values(columns.size());
+        std::vector<double> times;
+        for (const BlockInfo &block : m_blocks) {
+            if (block.series != static_cast<uint32_t>(series)) {
+                continue;
+            }
+            if (timeColumn >= 0 && (block.tMax < tStart || block.tMin > tEnd)) {
+                continue;
+            }
+            for (std::size_t k = 0; k < columns.size(); ++k) {
+                values[k].clear();
+                ReadBlockColumn(block, columns[k], values[k]);
+            }
+            bool inside = block.tMin >= tStart && block.tMax <= tEnd;
+            if (bounded && !inside) {
+                times.clear();
+                ReadBlockColumn(block, timeColumn, times);
+            }
+            for (std::size_t row = 0; row < block.rows; ++row) {
+                if (bounded && !inside && (row >= times.size() || times[row] < tStart || times[row] > tEnd)) {
+                    continue;
+                }
+                visit(values, row);
+            }
+        }
+    }
+
+    // Values of one column for the rows with tStart <= time <= tEnd (all rows by default)
+    std::vector<double> ReadColumn(int32_t series, const std::string &column,
+                                   double tStart = -std::numeric_limits<double>::infinity(),
+                                   double tEnd = std::numeric_limits<double>::infinity()) const {
+        std::vector<double> out;
+        int32_t target = FindColumn(series, column);
+        if (target < 0) {
+            return out;
+        }
+        Scan(series, {target}, tStart, tEnd, [&out](const std::vector<std::vector<double>> &values, std::size_t row) {
+            if (row < values[0].size()) {
+                out.push_back(values[0][row]);
+            }
+        });
+        return out;
+    }
+
+    uint64_t CountRows(int32_t series) const {
+        uint64_t rows = 0;
+        for (const BlockInfo &block : m_blocks) {
+            rows += block.series == static_cast<uint32_t>(series) ? block.rows : 0;
+        }
+        return rows;
+    }
+
+    int32_t TimeColumn(int32_t series) const {
+        const std::vector<ColumnInfo> &columns = m_series[series].columns;
+        for (uint32_t i = 0; i < columns.size(); ++i) {
+            if (columns[i].type == COLUMN_TIME) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+private:
+    void ParseHeader(const std::string &header) {
+        std::stringstream lines(header);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::size_t eq = line.find('=');
+            if (eq == std::string::npos) {
+                continue;
+            }
+            std::string key = line.substr(0, eq);
+            std::string value = line.substr(eq + 1);
+            if (key != "series") {
+                m_attributes[key] = value;
+                continue;
+            }
+            // name:col:type,col:type,...
+            SeriesInfo series;
+            std::size_t colon = value.find(':');
+            series.name = value.substr(0, colon);
+            std::stringstream columns(colon == std::string::npos ? "" : value.substr(colon + 1));
+            std::string column;
+            while (std::getline(columns, column, ',')) {
+                std::size_t split = column.rfind(':');
+                std::string type = column.substr(split + 1);
+                series.columns.push_back(ColumnInfo{column.substr(0, split),
+                                                    type == "time" ? COLUMN_TIME
+                                                                   : (type == "i64" ? COLUMN_I64 : COLUMN_F64)});
+            }
+            m_series.push_back(series);
+        }
+    }
+
+    bool ReadIndex() {
+        if (m_size < m_dataStart + 12) {
+            return false;
+        }
+        const char *trailer = m_data + m_size - 12;
+        if (std::memcmp(trailer + 8, "NCIX", 4) != 0) {
+            return false;
+        }
+        uint64_t indexOffset = columnar::LoadU64(trailer);
+        if (indexOffset < m_dataStart || indexOffset + 5 > m_size - 12 || m_data[indexOffset] != 'I') {
+            return false;
+        }
+        uint32_t count = columnar::LoadU32(m_data + indexOffset + 1);
+        if (indexOffset + 5 + static_cast<uint64_t>(count) * 32 > m_size - 12) {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            const char *entry = m_data + indexOffset + 5 + i * 32;
+            m_blocks.push_back(BlockInfo{columnar::LoadU64(entry), columnar::LoadU32(entry + 8),
+                                         columnar::LoadU32(entry + 12), columnar::LoadF64(entry + 16),
+                                         columnar::LoadF64(entry + 24)});
+        }
+        return true;
+    }
+
+    // Rebuild the index from the block headers of a file that was not closed
+    void ScanBlocks() {
+        uint64_t offset = m_dataStart;
+        while (offset + 25 <= m_size && m_data[offset] == 'B') {
+            const char *head = m_data + offset;
+            BlockInfo block{offset, columnar::LoadU32(head + 1), columnar::LoadU32(head + 5),
+                            columnar::LoadF64(head + 9), columnar::LoadF64(head + 17)};
+            if (block.series >= m_series.size()) {
+                break;
+            }
+            uint64_t next = offset + 25;
+            for (std::size_t c = 0; c < m_series[block.series].columns.size() && next + 5 <= m_size; ++c) {
+                next += 5 + columnar::LoadU32(m_data + next + 1);
+            }
+            if (next > m_size) {
+                break;
+            }
+            m_blocks.push_back(block);
+            offset = next;
+        }
+    }
+
+    // Step over the preceding column headers of the block and decode only `column`
+    void ReadBlockColumn(const BlockInfo &block, int32_t column, std::vector<double> &out) const {
+        uint64_t offset = block.offset + 25;
+        for (int32_t c = 0; offset + 5 <= m_size; ++c) {
+            uint32_t length = columnar::LoadU32(m_data + offset + 1);
+            if (offset + 5 + length > m_size) {
+                return;
+            }
+            if (c == column) {
+                columnar::Decode(static_cast<ColumnType>(m_data[offset]), m_data + offset + 5, length, block.rows, out);
+                return;
+            }
+            offset += 5 + length;
+        }
+    }
+
+    const char *m_data = nullptr;
+    uint64_t m_size = 0;
+    uint64_t m_dataStart = 0;
+    std::vector<SeriesInfo> m_series;
+    std::vector<BlockInfo> m_blocks;
+    std::map<std::string, std::string> m_attributes;
+};
+
+#endif // COLUMNAR_READER_H
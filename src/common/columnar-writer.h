@@ -0,0 +1,331 @@
+/*
+===================================================================
+    Columnar Telemetry Writer
+===================================================================
+
+    Compact binary container for sampled series, used instead of one
+    text line per sample. A file holds one or more named series (e.g.
+    cwnd, rtt, links), each with its own columns.
+
+    Rows are buffered in memory and written in blocks, column by
+    column, so every column of a block is contiguous on disk and each
+    block decodes on its own:
+
+      "NCOL" u8 version
+      u32 header length, header text of key=value lines:
+          series=<name>:<column>:<type>,<column>:<type>,...  (per series)
+          any run configuration set with SetAttribute()
+      per block:
+          'B' u32 series  u32 rows  f64 tMin  f64 tMax
+          per column: u8 codec  u32 byte length  encoded values
+      index (written by Close()):
+          'I' u32 blocks, per block: u64 offset u32 series u32 rows
+                                     f64 tMin f64 tMax
+          u64 index offset  "NCIX"
+
+    Codecs (the encoders reset at every block):
+      time  seconds as integer nanoseconds, delta-of-delta, zigzag
+            varint; periodic sampling costs one byte per row
+      f64   XOR with the previous value; one control byte (high
+            nibble: trailing zero bytes, low nibble: significant
+            bytes, 0 = unchanged) followed by the significant bytes
+      i64   delta to the previous value as a zigzag varint
+
+    tMin/tMax are the smallest and largest value of the series' first
+    time column in the block (rows need not be in time order) and make up
+    the on-disk time index used by columnar-reader.h.
+
+===================================================================
+*/
+
+#ifndef COLUMNAR_WRITER_H
+#define COLUMNAR_WRITER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+enum ColumnType : uint8_t {
+    COLUMN_F64 = 0,
+    COLUMN_I64 = 1,
+    COLUMN_TIME = 2
+};
+
+inline const char *ColumnTypeName(ColumnType type) {
+    return type == COLUMN_TIME ? "time" : (type == COLUMN_I64 ? "i64" : "f64");
+}
+
+// Encoders shared with columnar-reader.h
+namespace columnar {
+
+inline void PutVarint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t TimeToNs(double seconds) {
+    return static_cast<int64_t>(std::llround(seconds * 1e9));
+}
+
+inline void EncodeTime(const std::vector<double> &values, std::string &out) {
+    int64_t previous = 0;
+    int64_t previousDelta = 0;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        int64_t ns = TimeToNs(values[i]);
+        int64_t delta = ns - previous;
+        PutVarint(out, ZigZag(i == 0 ? ns : delta - previousDelta));
+        previousDelta = i == 0 ? 0 : delta;
+        previous = ns;
+    }
+}
+
+inline void EncodeDoubles(const std::vector<double> &values, std::string &out) {
+    uint64_t previous = 0;
+    for (double value : values) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint64_t x = bits ^ previous;
+        previous = bits;
+        if (x == 0) {
+            out.push_back(0);
+            continue;
+        }
+        int trailing = 0;
+        while (((x >> (8 * trailing)) & 0xff) == 0) {
+            ++trailing;
+        }
+        int significant = 8 - trailing;
+        while (((x >> (8 * (trailing + significant - 1))) & 0xff) == 0) {
+            --significant;
+        }
+        out.push_back(static_cast<char>((trailing << 4) | significant));
+        for (int b = 0; b < significant; ++b) {
+            out.push_back(static_cast<char>(x >> (8 * (trailing + b))));
+        }
+    }
+}
+
+inline void EncodeIntegers(const std::vector<int64_t> &values, std::string &out) {
+    int64_t previous = 0;
+    for (int64_t value : values) {
+        PutVarint(out, ZigZag(value - previous));
+        previous = value;
+    }
+}
+
+} // namespace columnar
+
+class ColumnarWriter {
+public:
+    static constexpr uint8_t VERSION = 2;
+
+    ~ColumnarWriter() {
+        Close();
+    }
+
+    // Declare every series and its columns before Open()
+    uint32_t AddSeries(const std::string &name) {
+        m_series.push_back(Series{name, {}, 0});
+        return m_series.size() - 1;
+    }
+
+    // Returns the column index used by Append()
+    uint32_t AddColumn(uint32_t series, const std::string &name, ColumnType type) {
+        m_series[series].columns.push_back(Column{name, type, {}, {}});
+        return m_series[series].columns.size() - 1;
+    }
+
+    // Run configuration stored in the header
+    void SetAttribute(const std::string &key, const std::string &value) {
+        m_attributes.push_back(key + "=" + value);
+    }
+
+    void SetBlockRows(uint32_t rows) {
+        m_blockRows = rows;
+    }
+
+    bool Open(const std::string &path) {
+        m_stream.open(path, std::ios::binary);
+        if (!m_stream.is_open()) {
+            std::cerr << "Columnar: cannot open " << path << std::endl;
+            return false;
+        }
+        std::string header;
+        for (const Series &series : m_series) {
+            header += "series=" + series.name;
+            for (const Column &column : series.columns) {
+                header += (&column == &series.columns[0] ? ":" : ",") + column.name + ":" + ColumnTypeName(column.type);
+            }
+            header += "\n";
+        }
+        for (const std::string &attribute : m_attributes) {
+            header += attribute + "\n";
+        }
+        m_stream.write("NCOL", 4);
+        m_stream.put(static_cast<char>(VERSION));
+        WriteU32(static_cast<uint32_t>(header.size()));
+        m_stream.write(header.data(), header.size());
+        m_offset = 9 + header.size();
+        return true;
+    }
+
+    bool IsOpen() const {
+        return m_stream.is_open();
+    }
+
+    // Underlying stream, e.g. for SnapshotBrancher::AddOutput (whole blocks only ever reach it)
+    std::ofstream &GetStream() {
+        return m_stream;
+    }
+
+    void Append(uint32_t series, uint32_t column, double value) {
+        m_series[series].columns[column].doubles.push_back(value);
+    }
+
+    void Append(uint32_t series, uint32_t column, int64_t value) {
+        m_series[series].columns[column].integers.push_back(value);
+    }
+
+    // Call once every column of the current row has been appended
+    void EndRow(uint32_t series) {
+        if (++m_series[series].rows >= m_blockRows) {
+            Flush(series);
+        }
+    }
+
+    void Flush() {
+        for (uint32_t series = 0; series < m_series.size(); ++series) {
+            Flush(series);
+        }
+    }
+
+    // Flush pending rows and append the block index
+    void Close() {
+        if (!m_stream.is_open()) {
+            return;
+        }
+        Flush();
+        uint64_t indexOffset = m_offset;
+        m_stream.put('I');
+        WriteU32(static_cast<uint32_t>(m_index.size()));
+        for (const BlockInfo &block : m_index) {
+            WriteU64(block.offset);
+            WriteU32(block.series);
+            WriteU32(block.rows);
+            WriteF64(block.tMin);
+            WriteF64(block.tMax);
+        }
+        WriteU64(indexOffset);
+        m_stream.write("NCIX", 4);
+        m_stream.close();
+    }
+
+private:
+    struct Column {
+        std::string name;
+        ColumnType type;
+        std::vector<double> doubles;
+        std::vector<int64_t> integers;
+    };
+
+    struct Series {
+        std::string name;
+        std::vector<Column> columns;
+        uint32_t rows;
+    };
+
+    struct BlockInfo {
+        uint64_t offset;
+        uint32_t series;
+        uint32_t rows;
+        double tMin;
+        double tMax;
+    };
+
+    void Flush(uint32_t id) {
+        Series &series = m_series[id];
+        if (series.rows == 0 || !m_stream.is_open()) {
+            return;
+        }
+        BlockInfo block = {m_offset, id, series.rows, 0.0, 0.0};
+        for (const Column &column : series.columns) {
+            if (column.type == COLUMN_TIME && !column.doubles.empty()) {
+                // Rows need not be in time order (per-flow windows, end-of-run flushes)
+                std::pair<std::vector<double>::const_iterator, std::vector<double>::const_iterator> range =
+                    std::minmax_element(column.doubles.begin(), column.doubles.end());
+                block.tMin = *range.first;
+                block.tMax = *range.second;
+                break;
+            }
+        }
+        m_stream.put('B');
+        WriteU32(id);
+        WriteU32(series.rows);
+        WriteF64(block.tMin);
+        WriteF64(block.tMax);
+        m_offset += 1 + 4 + 4 + 8 + 8;
+
+        std::string encoded;
+        for (Column &column : series.columns) {
+            encoded.clear();
+            if (column.type == COLUMN_TIME) {
+                columnar::EncodeTime(column.doubles, encoded);
+            } else if (column.type == COLUMN_F64) {
+                columnar::EncodeDoubles(column.doubles, encoded);
+            } else {
+                columnar::EncodeIntegers(column.integers, encoded);
+            }
+            m_stream.put(static_cast<char>(column.type));
+            WriteU32(static_cast<uint32_t>(encoded.size()));
+            m_stream.write(encoded.data(), encoded.size());
+            m_offset += 1 + 4 + encoded.size();
+            column.doubles.clear();
+            column.integers.clear();
+        }
+        m_index.push_back(block);
+        series.rows = 0;
+    }
+
+    void WriteU32(uint32_t value) {
+        char bytes[4];
+        for (int b = 0; b < 4; ++b) {
+            bytes[b] = static_cast<char>(value >> (8 * b));
+        }
+        m_stream.write(bytes, 4);
+    }
+
+    void WriteU64(uint64_t value) {
+        char bytes[8];
+        for (int b = 0; b < 8; ++b) {
+            bytes[b] = static_cast<char>(value >> (8 * b));
+        }
+        m_stream.write(bytes, 8);
+    }
+
+    void WriteF64(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        WriteU64(bits);
+    }
+
+    std::vector<Series> m_series;
+    std::vector<std::string> m_attributes;
+    std::vector<BlockInfo> m_index;
+    uint32_t m_blockRows = 4096;
+    uint64_t m_offset = 0;
+    std::ofstream m_stream;
+};
+
+#endif // COLUMNAR_WRITER_H
@@ -0,0 +1,281 @@
+/*
+===================================================================
+    CUBIC State Tracer
+===================================================================
+
+    Relates the cwnd sawtooth of the TCP programs to the CUBIC model
+    behind it. TcpCubic keeps W_max, K and the epoch private, so the
+    tracer follows each socket's public traces (CongestionWindow,
+    SlowStartThreshold, CongState, RTT) and replays the bookkeeping of
+    ns-3's TcpCubic with the C, Beta and FastConvergence defaults in
+    effect:
+
+      loss    ssthresh cut: W_max = cwnd, or cwnd * (1 + beta) / 2
+              with fast convergence below the previous W_max; the
+              epoch ends. TcpSocketBase::EnterRecovery switches to
+              CA_RECOVERY before it assigns ssthresh, so the first
+              ssthresh change after entering recovery (from CA_OPEN
+              or CWR) or CWR is the cut, applied to the cwnd at that
+              transition, unless the cut already came at the same
+              instant; later changes in the same episode are skipped.
+              An RTO cuts ssthresh before CA_LOSS is entered.
+      rto     CA_LOSS resets W_max to 0, slow start starts again
+      epoch   first RTT sample in congestion avoidance after a reset:
+              K = cbrt((W_max - cwnd) / C), origin = max(W_max, cwnd)
+      ssexit  slow start ends, with the reason
+                ssthresh  cwnd reached ssthresh
+                hystart   HyStart set ssthresh to cwnd (no loss)
+                loss      a loss ended slow start
+
+    Every change point writes one tab-separated row to <prefix>.cubic,
+    and to a "cubic" series of the columnar file (event as its index
+    in the list above: loss 0, rto 1, epoch 2, ssexit 3-5):
+
+      # time flow event cwnd ssthresh wMax K epochStart cubicTarget
+        tcpFriendly
+
+    Windows are in segments, K and epochStart in seconds (epochStart
+    is -1 outside an epoch). cubicTarget is origin + C * (t - K)^3 at
+    that time, with t = time - epochStart + minRtt as in TcpCubic.
+    tcpFriendly is the RFC 8312 estimate W_max * beta +
+    3 * (1 - beta) / (1 + beta) * (time - epochStart) / RTT; ns-3's
+    TcpCubic does not apply it, so the column shows where a
+    TCP-friendly CUBIC would sit above the cubic target.
+
+    Flows are the SocketRegistry flow ids: add Attach with
+    SocketRegistry::AddHook.
+
+===================================================================
+*/
+
+#ifndef CUBIC_TRACER_H
+#define CUBIC_TRACER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "metric-store.h"
+
+class CubicTracer {
+public:
+    enum Event { LOSS, RTO, EPOCH, SSEXIT_SSTHRESH, SSEXIT_HYSTART, SSEXIT_LOSS, EVENTS };
+
+    static CubicTracer &Instance() {
+        static CubicTracer tracer;
+        return tracer;
+    }
+
+    static const char *EventName(Event event) {
+        static const char *names[EVENTS] = {"loss", "rto", "epoch", "ssexit:ssthresh", "ssexit:hystart",
+                                            "ssexit:loss"};
+        return names[event];
+    }
+
+    // Declares the columnar series, so call before MetricStore::Open()
+    void Configure(MetricStore &metrics) {
+        m_metrics = &metrics;
+        m_series = metrics.AddSeries("cubic", {"flow", "event", "cwnd", "ssthresh", "wMax", "K", "epochStart",
+                                               "cubicTarget", "tcpFriendly"});
+    }
+
+    bool IsEnabled() const {
+        return m_stream.is_open();
+    }
+
+    // Read the TcpCubic defaults and open `path`
+    void Start(const std::string &path) {
+        m_c = DefaultDouble("C", 0.4);
+        m_beta = DefaultDouble("Beta", 0.7);
+        ns3::TypeId::AttributeInformation info;
+        ns3::Ptr<const ns3::BooleanValue> fast;
+        if (ns3::TypeId::LookupByName("ns3::TcpCubic").LookupAttributeByName("FastConvergence", &info) &&
+            (fast = ns3::DynamicCast<const ns3::BooleanValue>(info.initialValue))) {
+            m_fastConvergence = fast->Get();
+        }
+        m_stream.open(path);
+        m_stream << "# C " << m_c << ", beta " << m_beta << ", fast convergence " << m_fastConvergence << std::endl;
+        m_stream << "# time\tflow\tevent\tcwnd\tssthresh\twMax\tK\tepochStart\tcubicTarget\ttcpFriendly" << std::endl;
+    }
+
+    std::ofstream &GetStream() {
+        return m_stream;
+    }
+
+    // SocketRegistry hook
+    static void Attach(uint32_t flow, ns3::Ptr<ns3::TcpSocketBase> socket) {
+        CubicTracer &tracer = Instance();
+        if (flow >= tracer.m_flows.size()) {
+            tracer.m_flows.resize(flow + 1);
+        }
+        ns3::UintegerValue segmentSize;
+        socket->GetAttribute("SegmentSize", segmentSize);
+        ns3::UintegerValue initialSsthresh;
+        socket->GetAttribute("InitialSlowStartThreshold", initialSsthresh);
+        Flow &f = tracer.m_flows[flow];
+        f.segmentSize = std::max<uint32_t>(1, static_cast<uint32_t>(segmentSize.Get()));
+        f.ssthresh = static_cast<double>(initialSsthresh.Get()) / f.segmentSize;
+        socket->TraceConnectWithoutContext("CongestionWindow", ns3::MakeBoundCallback(&CubicTracer::NotifyCwnd, flow));
+        socket->TraceConnectWithoutContext("SlowStartThreshold",
+                                           ns3::MakeBoundCallback(&CubicTracer::NotifySsthresh, flow));
+        socket->TraceConnectWithoutContext("CongState", ns3::MakeBoundCallback(&CubicTracer::NotifyCongState, flow));
+        socket->TraceConnectWithoutContext("RTT", ns3::MakeBoundCallback(&CubicTracer::NotifyRtt, flow));
+    }
+
+    void Close() {
+        if (m_stream.is_open()) {
+            m_stream.close();
+        }
+    }
+
+private:
+    // Shadow of one TcpCubic instance; windows in segments
+    struct Flow {
+        uint32_t segmentSize = 1;
+        double cwnd = 0.0;
+        double ssthresh = 0.0;
+        bool open = true;      // CA_OPEN (or CA_DISORDER)
+        bool cutPending = false; // left CA_OPEN for recovery/CWR, ssthresh cut not seen yet
+        double cutCwnd = 0.0;    // cwnd when it left CA_OPEN
+        double lastCut = -1.0;   // time of the last loss cut
+        bool slowStart = true;
+        double wMax = 0.0;
+        double k = 0.0;
+        double origin = 0.0;
+        double epochStart = -1.0;
+        double minRtt = 0.0;
+        double rtt = 0.0;
+    };
+
+    CubicTracer() = default;
+
+    static double DefaultDouble(const std::string &name, double fallback) {
+        ns3::TypeId::AttributeInformation info;
+        if (!ns3::TypeId::LookupByName("ns3::TcpCubic").LookupAttributeByName(name, &info)) {
+            return fallback;
+        }
+        ns3::Ptr<const ns3::DoubleValue> value = ns3::DynamicCast<const ns3::DoubleValue>(info.initialValue);
+        return value ? value->Get() : fallback;
+    }
+
+    static void NotifyCwnd(uint32_t flow, uint32_t, uint32_t newCwnd) {
+        CubicTracer &tracer = Instance();
+        Flow &f = tracer.m_flows[flow];
+        f.cwnd = static_cast<double>(newCwnd) / f.segmentSize;
+        if (f.slowStart && f.open && f.cwnd >= f.ssthresh) {
+            f.slowStart = false;
+            tracer.Write(flow, SSEXIT_SSTHRESH);
+        }
+    }
+
+    static void NotifySsthresh(uint32_t flow, uint32_t oldSsthresh, uint32_t newSsthresh) {
+        CubicTracer &tracer = Instance();
+        Flow &f = tracer.m_flows[flow];
+        double ssthresh = static_cast<double>(newSsthresh) / f.segmentSize;
+        f.ssthresh = ssthresh;
+        if (oldSsthresh == 0 || (!f.open && !f.cutPending)) {
+            return; // initial value, or a further cut within the same episode
+        }
+        double cwnd = f.open ? f.cwnd : f.cutCwnd;
+        f.cutPending = false;
+        if (f.open && f.slowStart && ssthresh == f.cwnd) {
+            // HyStart: ssthresh = cwnd while the window is still open
+            f.slowStart = false;
+            tracer.Write(flow, SSEXIT_HYSTART);
+            return;
+        }
+        // Loss: TcpCubic::GetSsThresh, before cwnd is reduced
+        if (cwnd < f.wMax && tracer.m_fastConvergence) {
+            f.wMax = cwnd * (1 + tracer.m_beta) / 2;
+        } else {
+            f.wMax = cwnd;
+        }
+        f.epochStart = -1.0;
+        f.lastCut = ns3::Simulator::Now().GetSeconds();
+        if (f.slowStart) {
+            f.slowStart = false;
+            tracer.Write(flow, SSEXIT_LOSS);
+        }
+        tracer.Write(flow, LOSS);
+    }
+
+    static void NotifyCongState(uint32_t flow, ns3::TcpSocketState::TcpCongState_t oldState,
+                                ns3::TcpSocketState::TcpCongState_t newState) {
+        CubicTracer &tracer = Instance();
+        Flow &f = tracer.m_flows[flow];
+        bool open = newState == ns3::TcpSocketState::CA_OPEN || newState == ns3::TcpSocketState::CA_DISORDER;
+        bool cutState = newState == ns3::TcpSocketState::CA_RECOVERY || newState == ns3::TcpSocketState::CA_CWR;
+        if (cutState && (f.open || oldState == ns3::TcpSocketState::CA_CWR) &&
+            f.lastCut != ns3::Simulator::Now().GetSeconds()) {
+            // EnterRecovery sets CA_RECOVERY before it assigns the new ssthresh; a cut already seen
+            // at this instant (ssthresh assigned first) is not expected again
+            f.cutPending = true;
+            f.cutCwnd = f.cwnd;
+        }
+        if (open || newState == ns3::TcpSocketState::CA_LOSS) {
+            f.cutPending = false;
+        }
+        f.open = open;
+        if (newState == ns3::TcpSocketState::CA_LOSS) {
+            f.wMax = 0.0;
+            f.k = 0.0;
+            f.epochStart = -1.0;
+            f.slowStart = true;
+            tracer.Write(flow, RTO);
+        }
+    }
+
+    static void NotifyRtt(uint32_t flow, ns3::Time, ns3::Time newRtt) {
+        CubicTracer &tracer = Instance();
+        Flow &f = tracer.m_flows[flow];
+        f.rtt = newRtt.GetSeconds();
+        f.minRtt = f.minRtt > 0 ? std::min(f.minRtt, f.rtt) : f.rtt;
+        if (!f.open || f.slowStart || f.epochStart >= 0) {
+            return;
+        }
+        // TcpCubic::Update on the first ACK of a new epoch
+        f.epochStart = ns3::Simulator::Now().GetSeconds();
+        if (f.wMax <= f.cwnd) {
+            f.k = 0.0;
+            f.origin = f.cwnd;
+        } else {
+            f.k = std::cbrt((f.wMax - f.cwnd) / tracer.m_c);
+            f.origin = f.wMax;
+        }
+        tracer.Write(flow, EPOCH);
+    }
+
+    void Write(uint32_t flow, Event event) {
+        const Flow &f = m_flows[flow];
+        double now = ns3::Simulator::Now().GetSeconds();
+        double target = 0.0;
+        double friendly = 0.0;
+        if (f.epochStart >= 0) {
+            double t = now - f.epochStart + f.minRtt;
+            target = f.origin + m_c * std::pow(t - f.k, 3.0);
+            if (f.rtt > 0) {
+                friendly = f.wMax * m_beta + 3 * (1 - m_beta) / (1 + m_beta) * (now - f.epochStart) / f.rtt;
+            }
+        }
+        m_stream << now << "\t" << flow << "\t" << EventName(event) << "\t" << f.cwnd << "\t" << f.ssthresh << "\t"
+                 << f.wMax << "\t" << f.k << "\t" << f.epochStart << "\t" << target << "\t" << friendly << "\n";
+        if (m_metrics != nullptr) {
+            m_metrics->RecordRow(m_series, now, {static_cast<double>(flow), static_cast<double>(event), f.cwnd,
+                                                 f.ssthresh, f.wMax, f.k, f.epochStart, target, friendly});
+        }
+    }
+
+    double m_c = 0.4;
+    double m_beta = 0.7;
+    bool m_fastConvergence = true;
+    MetricStore *m_metrics = nullptr;
+    uint32_t m_series = 0;
+    std::ofstream m_stream;
+    std::vector<Flow> m_flows;
+};
+
+#endif // CUBIC_TRACER_H
@@ -0,0 +1,343 @@
+/*
+===================================================================
+    Flow-Hashed ECMP Routing
+===================================================================
+
+    Global routing installs one shortest path per destination, so in
+    the Ring and Mesh scenarios every flow between two nodes shares
+    the same links while the redundant ones stay idle.
+
+    EcmpRouting is added to every node's Ipv4ListRouting above global
+    routing. It computes hop distances between all nodes from the
+    interfaces that are currently up and forwards each packet to one
+    of the neighbours that is one hop closer to the destination node.
+    The neighbour is picked by hashing the flow (addresses, protocol,
+    ports) with the node id, so a flow keeps its path and different
+    flows spread over all equal-cost paths.
+
+    slack > 0 additionally lets the sending node use neighbours up to
+    `slack` hops further away (e.g. the two-hop detours of the full
+    mesh). Only the first hop may go sideways, so paths stay loop-free.
+
+    The origin node routes before the transport header is added for
+    UDP, so QUIC flows are told apart there only by their addresses;
+    transit nodes always see the ports.
+
+    Usage:
+    ------------------------
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    EcmpRouting::Install(nodes, slack);
+
+===================================================================
+*/
+
+#ifndef ECMP_ROUTING_H
+#define ECMP_ROUTING_H
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+// ns-3.36 passes the RouteInput callbacks by const reference. The QUIC programs build against
+// ns-3.41 and define this to 1 before including the header; the TCP programs target ns-3.35.
+#ifndef NS3_CONST_REF_CALLBACKS
+#define NS3_CONST_REF_CALLBACKS 0
+#endif
+
+// Adjacency and hop distances shared by the EcmpRouting instances of one scenario
+class EcmpTopology : public ns3::SimpleRefCount<EcmpTopology> {
+public:
+    struct Hop {
+        uint32_t interface;       // outgoing interface on this node
+        ns3::Ipv4Address gateway; // neighbour's address on the link
+        uint32_t neighbour;       // neighbour node id
+    };
+
+    explicit EcmpTopology(uint32_t slack) : m_slack(slack) {}
+
+    void MarkDirty() {
+        m_dirty = true;
+    }
+
+    // Node owning `address`, or -1 if it is not a unicast address of a known node
+    int32_t NodeOf(ns3::Ipv4Address address) {
+        Update();
+        auto it = m_owner.find(address.Get());
+        return it == m_owner.end() ? -1 : static_cast<int32_t>(it->second);
+    }
+
+    // Next-hop candidates from `node` towards `destination`; origin candidates include the slack detours
+    const std::vector<Hop> &Candidates(uint32_t node, uint32_t destination, bool origin) {
+        Update();
+        return origin ? m_origin[node][destination] : m_downhill[node][destination];
+    }
+
+    uint32_t Distance(uint32_t from, uint32_t to) {
+        Update();
+        return m_distance[from][to];
+    }
+
+private:
+    static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+
+    void Update() {
+        if (!m_dirty) {
+            return;
+        }
+        m_dirty = false;
+        uint32_t n = ns3::NodeList::GetNNodes();
+        std::vector<std::vector<Hop>> adjacency(n);
+        m_owner.clear();
+
+        for (uint32_t id = 0; id < n; ++id) {
+            ns3::Ptr<ns3::Ipv4> ipv4 = ns3::NodeList::GetNode(id)->GetObject<ns3::Ipv4>();
+            if (!ipv4) {
+                continue;
+            }
+            for (uint32_t i = 1; i < ipv4->GetNInterfaces(); ++i) {
+                for (uint32_t a = 0; a < ipv4->GetNAddresses(i); ++a) {
+                    m_owner[ipv4->GetAddress(i, a).GetLocal().Get()] = id;
+                }
+                if (!ipv4->IsUp(i)) {
+                    continue;
+                }
+                ns3::Ptr<ns3::NetDevice> device = ipv4->GetNetDevice(i);
+                ns3::Ptr<ns3::Channel> channel = device->GetChannel();
+                if (!channel) {
+                    continue;
+                }
+                for (std::size_t k = 0; k < channel->GetNDevices(); ++k) {
+                    ns3::Ptr<ns3::NetDevice> peer = channel->GetDevice(k);
+                    if (peer == device) {
+                        continue;
+                    }
+                    ns3::Ptr<ns3::Ipv4> peerIpv4 = peer->GetNode()->GetObject<ns3::Ipv4>();
+                    int32_t peerInterface = peerIpv4 ? peerIpv4->GetInterfaceForDevice(peer) : -1;
+                    if (peerInterface < 0 || !peerIpv4->IsUp(peerInterface) || peerIpv4->GetNAddresses(peerInterface) == 0) {
+                        continue;
+                    }
+                    adjacency[id].push_back(
+                        Hop{i, peerIpv4->GetAddress(peerInterface, 0).GetLocal(), peer->GetNode()->GetId()});
+                }
+            }
+        }
+
+        // Breadth-first search from every node (links are symmetric)
+        m_distance.assign(n, std::vector<uint32_t>(n, UNREACHABLE));
+        for (uint32_t source = 0; source < n; ++source) {
+            std::deque<uint32_t> queue{source};
+            m_distance[source][source] = 0;
+            while (!queue.empty()) {
+                uint32_t node = queue.front();
+                queue.pop_front();
+                for (const Hop &hop : adjacency[node]) {
+                    if (m_distance[source][hop.neighbour] == UNREACHABLE) {
+                        m_distance[source][hop.neighbour] = m_distance[source][node] + 1;
+                        queue.push_back(hop.neighbour);
+                    }
+                }
+            }
+        }
+
+        m_downhill.assign(n, std::vector<std::vector<Hop>>(n));
+        m_origin.assign(n, std::vector<std::vector<Hop>>(n));
+        for (uint32_t node = 0; node < n; ++node) {
+            for (uint32_t destination = 0; destination < n; ++destination) {
+                uint32_t own = m_distance[node][destination];
+                if (destination == node || own == UNREACHABLE) {
+                    continue;
+                }
+                for (const Hop &hop : adjacency[node]) {
+                    uint32_t via = m_distance[hop.neighbour][destination];
+                    if (via == UNREACHABLE) {
+                        continue;
+                    }
+                    if (via + 1 == own) {
+                        m_downhill[node][destination].push_back(hop);
+                    }
+                    if (via + 1 <= own + m_slack) {
+                        m_origin[node][destination].push_back(hop);
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t m_slack;
+    bool m_dirty = true;
+    std::map<uint32_t, uint32_t> m_owner;                    // address -> node id
+    std::vector<std::vector<uint32_t>> m_distance;           // [from][to] in hops
+    std::vector<std::vector<std::vector<Hop>>> m_downhill;   // [node][destination]
+    std::vector<std::vector<std::vector<Hop>>> m_origin;     // [node][destination], with slack
+};
+
+class EcmpRouting : public ns3::Ipv4RoutingProtocol {
+public:
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid = ns3::TypeId("EcmpRouting").SetParent<ns3::Ipv4RoutingProtocol>();
+        return tid;
+    }
+
+    // Add flow-hashed ECMP above global routing on every node of `nodes`
+    static void Install(const ns3::NodeContainer &nodes, uint32_t slack) {
+        ns3::Ptr<EcmpTopology> topology = ns3::Create<EcmpTopology>(slack);
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            ns3::Ptr<ns3::Ipv4> ipv4 = nodes.Get(i)->GetObject<ns3::Ipv4>();
+            ns3::Ptr<ns3::Ipv4ListRouting> list = ns3::DynamicCast<ns3::Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+            if (!list) {
+                std::cerr << "ECMP: node " << nodes.Get(i)->GetId() << " does not use Ipv4ListRouting" << std::endl;
+                continue;
+            }
+            ns3::Ptr<EcmpRouting> ecmp = ns3::CreateObject<EcmpRouting>();
+            ecmp->m_topology = topology;
+            list->AddRoutingProtocol(ecmp, 10);
+        }
+    }
+
+    ns3::Ptr<ns3::Ipv4Route> RouteOutput(ns3::Ptr<ns3::Packet> p, const ns3::Ipv4Header &header,
+                                         ns3::Ptr<ns3::NetDevice> oif,
+                                         ns3::Socket::SocketErrno &sockerr) override {
+        // Only TCP has its header in place when the sending node routes
+        bool ports = p && header.GetProtocol() == 6;
+        ns3::Ptr<ns3::Ipv4Route> route = Lookup(p, header, true, ports, oif);
+        sockerr = route ? ns3::Socket::ERROR_NOTERROR : ns3::Socket::ERROR_NOROUTETOHOST;
+        return route;
+    }
+
+#if NS3_CONST_REF_CALLBACKS
+    bool RouteInput(ns3::Ptr<const ns3::Packet> p, const ns3::Ipv4Header &header,
+                    ns3::Ptr<const ns3::NetDevice> idev, const UnicastForwardCallback &ucb,
+                    const MulticastForwardCallback &mcb, const LocalDeliverCallback &lcb,
+                    const ErrorCallback &ecb) override {
+        return Forward(p, header, idev, ucb);
+    }
+#else
+    bool RouteInput(ns3::Ptr<const ns3::Packet> p, const ns3::Ipv4Header &header,
+                    ns3::Ptr<const ns3::NetDevice> idev, UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                    LocalDeliverCallback lcb, ErrorCallback ecb) override {
+        return Forward(p, header, idev, ucb);
+    }
+#endif
+
+    void NotifyInterfaceUp(uint32_t interface) override {
+        m_topology->MarkDirty();
+    }
+
+    void NotifyInterfaceDown(uint32_t interface) override {
+        m_topology->MarkDirty();
+    }
+
+    void NotifyAddAddress(uint32_t interface, ns3::Ipv4InterfaceAddress address) override {
+        m_topology->MarkDirty();
+    }
+
+    void NotifyRemoveAddress(uint32_t interface, ns3::Ipv4InterfaceAddress address) override {
+        m_topology->MarkDirty();
+    }
+
+    void SetIpv4(ns3::Ptr<ns3::Ipv4> ipv4) override {
+        m_ipv4 = ipv4;
+    }
+
+    void PrintRoutingTable(ns3::Ptr<ns3::OutputStreamWrapper> stream,
+                           ns3::Time::Unit unit = ns3::Time::S) const override {
+        std::ostream &os = *stream->GetStream();
+        uint32_t self = m_ipv4->GetObject<ns3::Node>()->GetId();
+        os << "Node " << self << " ECMP next hops (destination node: interface/gateway ...)" << std::endl;
+        for (uint32_t destination = 0; destination < ns3::NodeList::GetNNodes(); ++destination) {
+            const std::vector<EcmpTopology::Hop> &hops = m_topology->Candidates(self, destination, false);
+            if (hops.empty()) {
+                continue;
+            }
+            os << "  " << destination << ":";
+            for (const EcmpTopology::Hop &hop : hops) {
+                os << " " << hop.interface << "/" << hop.gateway;
+            }
+            os << std::endl;
+        }
+    }
+
+protected:
+    void DoDispose() override {
+        m_ipv4 = nullptr;
+        m_topology = nullptr;
+        ns3::Ipv4RoutingProtocol::DoDispose();
+    }
+
+private:
+    bool Forward(ns3::Ptr<const ns3::Packet> p, const ns3::Ipv4Header &header, ns3::Ptr<const ns3::NetDevice> idev,
+                 const UnicastForwardCallback &ucb) {
+        // Local delivery and multicast are left to the list and global routing
+        if (header.GetDestination().IsMulticast() || header.GetDestination().IsBroadcast()) {
+            return false;
+        }
+        int32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+        if (iif < 0 || !m_ipv4->IsForwarding(iif)) {
+            return false;
+        }
+        ns3::Ptr<ns3::Ipv4Route> route = Lookup(p, header, false, true, nullptr);
+        if (!route) {
+            return false;
+        }
+        ucb(route, p, header);
+        return true;
+    }
+
+    ns3::Ptr<ns3::Ipv4Route> Lookup(ns3::Ptr<const ns3::Packet> p, const ns3::Ipv4Header &header, bool origin,
+                                    bool ports, ns3::Ptr<ns3::NetDevice> oif) {
+        uint32_t self = m_ipv4->GetObject<ns3::Node>()->GetId();
+        int32_t destination = m_topology->NodeOf(header.GetDestination());
+        if (destination < 0 || static_cast<uint32_t>(destination) == self) {
+            return nullptr;
+        }
+        const std::vector<EcmpTopology::Hop> &all = m_topology->Candidates(self, destination, origin);
+        std::vector<const EcmpTopology::Hop *> usable;
+        for (const EcmpTopology::Hop &hop : all) {
+            if (!oif || m_ipv4->GetNetDevice(hop.interface) == oif) {
+                usable.push_back(&hop);
+            }
+        }
+        if (usable.empty()) {
+            return nullptr;
+        }
+        const EcmpTopology::Hop &hop = *usable[FlowHash(p, header, ports, self) % usable.size()];
+
+        ns3::Ptr<ns3::Ipv4Route> route = ns3::Create<ns3::Ipv4Route>();
+        route->SetDestination(header.GetDestination());
+        route->SetGateway(hop.gateway);
+        route->SetOutputDevice(m_ipv4->GetNetDevice(hop.interface));
+        route->SetSource(m_ipv4->GetAddress(hop.interface, 0).GetLocal());
+        return route;
+    }
+
+    // FNV-1a over the flow identifier; the node id is mixed in so consecutive hops split independently
+    static uint32_t FlowHash(ns3::Ptr<const ns3::Packet> p, const ns3::Ipv4Header &header, bool ports, uint32_t node) {
+        uint8_t key[17] = {0};
+        uint32_t fields[3] = {header.GetSource().Get(), header.GetDestination().Get(), node};
+        for (int i = 0; i < 3; ++i) {
+            for (int b = 0; b < 4; ++b) {
+                key[i * 4 + b] = static_cast<uint8_t>(fields[i] >> (8 * b));
+            }
+        }
+        key[12] = header.GetProtocol();
+        // TCP and UDP both start with the 16-bit source and destination ports
+        if (ports && p && p->GetSize() >= 4 && (header.GetProtocol() == 6 || header.GetProtocol() == 17)) {
+            p->CopyData(key + 13, 4);
+        }
+        uint32_t hash = 2166136261u;
+        for (uint8_t byte : key) {
+            hash = (hash ^ byte) * 16777619u;
+        }
+        return hash;
+    }
+
+    ns3::Ptr<ns3::Ipv4> m_ipv4;
+    ns3::Ptr<EcmpTopology> m_topology;
+};
+
+#endif // ECMP_ROUTING_H
@@ -0,0 +1,231 @@
+/*
+===================================================================
+    Router Flow Aggregation
+===================================================================
+
+    Per-flow counters at one node without capturing packets. Every
+    IPv4 packet the node receives (Ipv4L3Protocol "Rx", before any
+    header is removed) is parsed in place from its first bytes, and
+    its 5-tuple (src, dst, protocol, ports) updates one flow record:
+
+      packets, bytes            per export interval and in total
+      flowStart, lastSeen       first and last packet of the flow
+      iatMean/Min/Max           packet inter-arrival times in the
+                                interval (ms)
+
+    Records live in one open-addressing table (linear probing,
+    power-of-two size, grown at 3/4 load), so a packet costs a hash
+    and usually one cache line, without per-flow allocations.
+
+    Every period, the flows that saw packets in the interval are
+    exported, one tab-separated line each, with the interval counters
+    as deltas, like IPFIX active-timeout records:
+
+      # time src dst proto srcPort dstPort packets bytes totalPackets
+        totalBytes flowStart lastSeen iatMean iatMin iatMax
+
+    Flows are never expired; with the fixed client/server sets of
+    these topologies the table stays small.
+
+===================================================================
+*/
+
+#ifndef FLOW_AGGREGATOR_H
+#define FLOW_AGGREGATOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+class FlowAggregator {
+public:
+    // Aggregate the IPv4 traffic received by `node`, exporting every `period` to `path`
+    void Start(ns3::Ptr<ns3::Node> node, ns3::Time period, const std::string &path) {
+        m_period = period;
+        m_table.assign(1024, FlowRecord());
+        m_stream.open(path);
+        m_stream << "# flows received by node " << node->GetId() << ", exported every " << period.GetSeconds()
+                 << " s" << std::endl;
+        m_stream << "# time\tsrc\tdst\tproto\tsrcPort\tdstPort\tpackets\tbytes\ttotalPackets\ttotalBytes\tflowStart"
+                    "\tlastSeen\tiatMean\tiatMin\tiatMax"
+                 << std::endl;
+        ns3::Ptr<ns3::Ipv4L3Protocol> ipv4 = node->GetObject<ns3::Ipv4L3Protocol>();
+        ipv4->TraceConnectWithoutContext("Rx", ns3::MakeBoundCallback(&FlowAggregator::NotifyRx, this));
+        ns3::Simulator::Schedule(period, &FlowAggregator::Export, this, true);
+    }
+
+    bool IsEnabled() const {
+        return !m_period.IsZero();
+    }
+
+    // Export stream, e.g. for SnapshotBrancher::AddOutput
+    std::ofstream &GetStream() {
+        return m_stream;
+    }
+
+    // Export the last partial interval and close the file
+    void Close() {
+        if (m_stream.is_open()) {
+            Export(false);
+            m_stream.close();
+        }
+    }
+
+private:
+    // Fixed-size slot, the 5-tuple first; `used` marks occupied slots
+    struct FlowRecord {
+        uint32_t src = 0;
+        uint32_t dst = 0;
+        uint16_t srcPort = 0;
+        uint16_t dstPort = 0;
+        uint8_t protocol = 0;
+        bool used = false;
+        uint32_t intervalPackets = 0;
+        uint64_t intervalBytes = 0;
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        int64_t firstNs = 0;
+        int64_t lastNs = 0;
+        int64_t iatSumNs = 0;
+        int64_t iatMinNs = 0;
+        int64_t iatMaxNs = 0;
+    };
+
+    static void NotifyRx(FlowAggregator *aggregator, ns3::Ptr<const ns3::Packet> packet, ns3::Ptr<ns3::Ipv4>,
+                         uint32_t) {
+        aggregator->Account(packet);
+    }
+
+    static uint32_t Load32(const uint8_t *p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    void Account(ns3::Ptr<const ns3::Packet> packet) {
+        // IPv4 header (up to 60 bytes) plus the first 4 bytes of TCP/UDP
+        uint8_t header[64];
+        uint32_t length = packet->CopyData(header, sizeof(header));
+        if (length < 20 || (header[0] >> 4) != 4) {
+            return;
+        }
+        FlowRecord key;
+        uint32_t ihl = (header[0] & 0x0f) * 4u;
+        bool firstFragment = ((header[6] & 0x1f) | header[7]) == 0;
+        key.protocol = header[9];
+        key.src = Load32(header + 12);
+        key.dst = Load32(header + 16);
+        if ((key.protocol == 6 || key.protocol == 17) && firstFragment && length >= ihl + 4) {
+            key.srcPort = static_cast<uint16_t>((header[ihl] << 8) | header[ihl + 1]);
+            key.dstPort = static_cast<uint16_t>((header[ihl + 2] << 8) | header[ihl + 3]);
+        }
+
+        FlowRecord &flow = Lookup(key);
+        int64_t now = ns3::Simulator::Now().GetNanoSeconds();
+        if (flow.packets == 0) {
+            flow.firstNs = now;
+        } else if (flow.intervalPackets > 0) {
+            int64_t iat = now - flow.lastNs;
+            flow.iatSumNs += iat;
+            flow.iatMinNs = flow.intervalPackets == 1 ? iat : std::min(flow.iatMinNs, iat);
+            flow.iatMaxNs = std::max(flow.iatMaxNs, iat);
+        }
+        flow.lastNs = now;
+        flow.packets++;
+        flow.bytes += packet->GetSize();
+        flow.intervalPackets++;
+        flow.intervalBytes += packet->GetSize();
+    }
+
+    static std::size_t Hash(const FlowRecord &key) {
+        uint64_t h = (static_cast<uint64_t>(key.src) << 32) | key.dst;
+        h ^= ((static_cast<uint64_t>(key.srcPort) << 24) | (static_cast<uint64_t>(key.dstPort) << 8) | key.protocol) *
+             0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+    static bool SameFlow(const FlowRecord &a, const FlowRecord &b) {
+        return a.src == b.src && a.dst == b.dst && a.srcPort == b.srcPort && a.dstPort == b.dstPort &&
+               a.protocol == b.protocol;
+    }
+
+    // Slot of `key`, inserted if new
+    FlowRecord &Lookup(const FlowRecord &key) {
+        std::size_t mask = m_table.size() - 1;
+        for (std::size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+            FlowRecord &slot = m_table[i];
+            if (slot.used && SameFlow(slot, key)) {
+                return slot;
+            }
+            if (!slot.used) {
+                if ((m_flows + 1) * 4 > m_table.size() * 3) {
+                    Grow();
+                    return Lookup(key);
+                }
+                slot = key;
+                slot.used = true;
+                m_flows++;
+                return slot;
+            }
+        }
+    }
+
+    void Grow() {
+        std::vector<FlowRecord> old(m_table.size() * 2);
+        old.swap(m_table);
+        std::size_t mask = m_table.size() - 1;
+        for (const FlowRecord &flow : old) {
+            if (!flow.used) {
+                continue;
+            }
+            std::size_t i = Hash(flow) & mask;
+            while (m_table[i].used) {
+                i = (i + 1) & mask;
+            }
+            m_table[i] = flow;
+        }
+    }
+
+    static std::string Address(uint32_t address) {
+        return std::to_string(address >> 24) + "." + std::to_string((address >> 16) & 0xff) + "." +
+               std::to_string((address >> 8) & 0xff) + "." + std::to_string(address & 0xff);
+    }
+
+    void Export(bool reschedule = true) {
+        double now = ns3::Simulator::Now().GetSeconds();
+        for (FlowRecord &flow : m_table) {
+            if (!flow.used || flow.intervalPackets == 0) {
+                continue;
+            }
+            uint32_t gaps = flow.intervalPackets - 1;
+            m_stream << now << "\t" << Address(flow.src) << "\t" << Address(flow.dst) << "\t"
+                     << static_cast<uint32_t>(flow.protocol) << "\t" << flow.srcPort << "\t" << flow.dstPort << "\t"
+                     << flow.intervalPackets << "\t" << flow.intervalBytes << "\t" << flow.packets << "\t"
+                     << flow.bytes << "\t" << flow.firstNs / 1e9 << "\t" << flow.lastNs / 1e9 << "\t"
+                     << (gaps > 0 ? flow.iatSumNs / 1e6 / gaps : 0.0) << "\t" << flow.iatMinNs / 1e6 << "\t"
+                     << flow.iatMaxNs / 1e6 << "\n";
+            flow.intervalPackets = 0;
+            flow.intervalBytes = 0;
+            flow.iatSumNs = 0;
+            flow.iatMinNs = 0;
+            flow.iatMaxNs = 0;
+        }
+        m_stream.flush();
+        if (reschedule) {
+            ns3::Simulator::Schedule(m_period, &FlowAggregator::Export, this, true);
+        }
+    }
+
+    ns3::Time m_period;
+    std::vector<FlowRecord> m_table;
+    std::size_t m_flows = 0;
+    std::ofstream m_stream;
+};
+
+#endif // FLOW_AGGREGATOR_H
@@ -0,0 +1,209 @@
+/*
+===================================================================
+    Lightweight Flow Sink
+===================================================================
+
+    Drop-in replacement for PacketSink for scenarios that only need
+    received byte and read counts. PacketSink builds an Rx trace with
+    the peer address for every read (RecvFrom), keeps per-peer
+    bookkeeping and checks optional SeqTsSize headers. FlowSink reads
+    with plain Recv(), looks only at the size of what it gets back,
+    and drops it; the payload is never copied out of the packet.
+
+    Every connection accepted by the listening socket gets one slot in
+    a flat counter array (bytes, reads, first/last read). The slot
+    index is bound into the socket's receive callback, so a read does
+    no lookup, even with thousands of concurrent connections. Slot 0
+    counts datagrams received on the listening socket itself.
+
+    Trace source "Rx" (uint32_t flow, uint32_t bytes) fires once per
+    read, "Accept" (uint32_t flow, Ptr<Socket>) once per accepted
+    connection. FlowSinkHelper takes the same arguments as
+    PacketSinkHelper.
+
+    One FlowSink on one port can therefore serve every client of a
+    scenario, as a real server does (Star: --clients). WriteReport()
+    lists the slots, one line per connection:
+
+      # flow bytes reads firstRx lastRx goodputMbps
+
+===================================================================
+*/
+
+#ifndef FLOW_SINK_H
+#define FLOW_SINK_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+
+class FlowSink : public ns3::Application {
+public:
+    struct FlowCounters {
+        uint64_t bytes = 0;
+        uint64_t reads = 0;
+        double firstRx = 0.0;
+        double lastRx = 0.0;
+    };
+
+    typedef void (*RxTracedCallback)(uint32_t flow, uint32_t bytes);
+    typedef void (*AcceptTracedCallback)(uint32_t flow, ns3::Ptr<ns3::Socket> socket);
+
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid = ns3::TypeId("ns3::FlowSink")
+                                     .SetParent<ns3::Application>()
+                                     .SetGroupName("Applications")
+                                     .AddConstructor<FlowSink>()
+                                     .AddTraceSource("Rx", "Bytes read from one flow",
+                                                     ns3::MakeTraceSourceAccessor(&FlowSink::m_rxTrace),
+                                                     "ns3::FlowSink::RxTracedCallback")
+                                     .AddTraceSource("Accept", "Connection accepted into a new flow slot",
+                                                     ns3::MakeTraceSourceAccessor(&FlowSink::m_acceptTrace),
+                                                     "ns3::FlowSink::AcceptTracedCallback");
+        return tid;
+    }
+
+    // Socket factory (e.g. "ns3::TcpSocketFactory") and local address to listen on
+    void Setup(const std::string &protocol, const ns3::Address &local) {
+        m_protocol = ns3::TypeId::LookupByName(protocol);
+        m_local = local;
+    }
+
+    uint64_t GetTotalRx() const {
+        return m_totalRx;
+    }
+
+    uint64_t GetTotalReads() const {
+        return m_totalReads;
+    }
+
+    // Slot 0: datagrams on the listening socket; slot i: i-th accepted connection
+    const std::vector<FlowCounters> &GetFlows() const {
+        return m_flows;
+    }
+
+    // Per-connection counters; goodput over the connection's first to last read
+    void WriteReport(const std::string &path) const {
+        std::ofstream report(path);
+        report << "# flow\tbytes\treads\tfirstRx\tlastRx\tgoodputMbps" << std::endl;
+        for (uint32_t i = 0; i < m_flows.size(); ++i) {
+            const FlowCounters &c = m_flows[i];
+            if (c.reads == 0) {
+                continue;
+            }
+            double active = c.lastRx - c.firstRx;
+            report << i << "\t" << c.bytes << "\t" << c.reads << "\t" << c.firstRx << "\t" << c.lastRx << "\t"
+                   << (active > 0 ? c.bytes * 8.0 / active / 1e6 : 0.0) << "\n";
+        }
+    }
+
+protected:
+    void DoDispose() override {
+        m_socket = nullptr;
+        m_accepted.clear();
+        ns3::Application::DoDispose();
+    }
+
+private:
+    void StartApplication() override {
+        if (!m_socket) {
+            m_socket = ns3::Socket::CreateSocket(GetNode(), m_protocol);
+            if (m_socket->Bind(m_local) == -1) {
+                std::cerr << "FlowSink: failed to bind the listening socket" << std::endl;
+                exit(1);
+            }
+            m_socket->Listen();
+            m_socket->ShutdownSend();
+        }
+        if (m_flows.empty()) {
+            m_flows.push_back(FlowCounters());
+        }
+        m_socket->SetRecvCallback(ns3::MakeBoundCallback(&FlowSink::HandleRead, this, 0u));
+        m_socket->SetAcceptCallback(ns3::MakeNullCallback<bool, ns3::Ptr<ns3::Socket>, const ns3::Address &>(),
+                                    ns3::MakeCallback(&FlowSink::HandleAccept, this));
+    }
+
+    void StopApplication() override {
+        for (ns3::Ptr<ns3::Socket> socket : m_accepted) {
+            socket->Close();
+        }
+        m_accepted.clear();
+        if (m_socket) {
+            m_socket->Close();
+            m_socket->SetRecvCallback(ns3::MakeNullCallback<void, ns3::Ptr<ns3::Socket>>());
+        }
+    }
+
+    void HandleAccept(ns3::Ptr<ns3::Socket> socket, const ns3::Address &) {
+        uint32_t flow = static_cast<uint32_t>(m_flows.size());
+        m_flows.push_back(FlowCounters());
+        socket->SetRecvCallback(ns3::MakeBoundCallback(&FlowSink::HandleRead, this, flow));
+        m_accepted.push_back(socket);
+        m_acceptTrace(flow, socket);
+    }
+
+    static void HandleRead(FlowSink *sink, uint32_t flow, ns3::Ptr<ns3::Socket> socket) {
+        double now = ns3::Simulator::Now().GetSeconds();
+        FlowCounters &counters = sink->m_flows[flow];
+        ns3::Ptr<ns3::Packet> packet;
+        while ((packet = socket->Recv())) {
+            uint32_t bytes = packet->GetSize();
+            if (bytes == 0) {
+                break; // EOF
+            }
+            if (counters.reads == 0) {
+                counters.firstRx = now;
+            }
+            counters.bytes += bytes;
+            counters.reads++;
+            counters.lastRx = now;
+            sink->m_totalRx += bytes;
+            sink->m_totalReads++;
+            sink->m_rxTrace(flow, bytes);
+        }
+    }
+
+    ns3::TypeId m_protocol;
+    ns3::Address m_local;
+    ns3::Ptr<ns3::Socket> m_socket;
+    std::vector<ns3::Ptr<ns3::Socket>> m_accepted;
+    std::vector<FlowCounters> m_flows;
+    uint64_t m_totalRx = 0;
+    uint64_t m_totalReads = 0;
+    ns3::TracedCallback<uint32_t, uint32_t> m_rxTrace;
+    ns3::TracedCallback<uint32_t, ns3::Ptr<ns3::Socket>> m_acceptTrace;
+};
+
+// Same interface as PacketSinkHelper
+class FlowSinkHelper {
+public:
+    FlowSinkHelper(const std::string &protocol, const ns3::Address &local) : m_protocol(protocol), m_local(local) {}
+
+    ns3::ApplicationContainer Install(ns3::Ptr<ns3::Node> node) const {
+        ns3::Ptr<FlowSink> sink = ns3::CreateObject<FlowSink>();
+        sink->Setup(m_protocol, m_local);
+        node->AddApplication(sink);
+        return ns3::ApplicationContainer(sink);
+    }
+
+    ns3::ApplicationContainer Install(const ns3::NodeContainer &nodes) const {
+        ns3::ApplicationContainer apps;
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            apps.Add(Install(nodes.Get(i)));
+        }
+        return apps;
+    }
+
+private:
+    std::string m_protocol;
+    ns3::Address m_local;
+};
+
+#endif // FLOW_SINK_H
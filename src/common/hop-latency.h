@@ -0,0 +1,391 @@
+/*
+===================================================================
+    Per-Hop Latency Decomposition
+===================================================================
+
+    Splits the end-to-end delay into its per-hop parts. Every
+    transmitting device (one direction of a link) times each packet
+    through three stages:
+
+      queue          entry into the queue disc (or the device, when
+                     it has none) until PhyTxBegin
+      serialization  PhyTxBegin until PhyTxEnd
+      propagation    PhyTxEnd until PhyRxEnd at the first receiver
+                     on the channel
+
+    The stage start times are kept per device and packet uid, which
+    survives the copies made along the path; drops (MacTxDrop, queue
+    disc Drop) discard them. Sojourn is the sum of the three.
+
+    On its first enqueue each packet also gets a HopOriginTag (send
+    time and node, 12 bytes). Where IPv4 delivers it locally, the
+    tag gives the one-way delay of the (source, destination) pair;
+    the RTT of a pair is the sum of its two one-way delays, i.e. the
+    path RTT without end-host delays such as delayed ACKs.
+
+    All durations go to histograms with 4 log-spaced bins per octave
+    from 1 us, so p50/p90/p99 are accurate to about 19%.
+
+    Outputs:
+    ------------------------
+      WriteReport()      per hop: packets, queue mean/p99,
+                         serialization and propagation means, sojourn
+                         mean/p50/p99 (ms); per node pair: one-way
+                         delay mean/p50/p99, reverse delay and RTT
+      WriteHistograms()  one row per non-empty bin:
+                           hop|pair  id  stage  upperMs  count
+
+    Call Install() once the addresses are assigned, since that is
+    when the default queue discs are created.
+
+===================================================================
+*/
+
+#ifndef HOP_LATENCY_H
+#define HOP_LATENCY_H
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+
+// Time and node at which a packet first entered a queue
+class HopOriginTag : public ns3::Tag {
+public:
+    HopOriginTag() = default;
+
+    HopOriginTag(int64_t timeNs, uint32_t node) : m_timeNs(timeNs), m_node(node) {}
+
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid = ns3::TypeId("ns3::HopOriginTag")
+                                     .SetParent<ns3::Tag>()
+                                     .SetGroupName("Network")
+                                     .AddConstructor<HopOriginTag>();
+        return tid;
+    }
+
+    ns3::TypeId GetInstanceTypeId() const override {
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize() const override {
+        return 12;
+    }
+
+    void Serialize(ns3::TagBuffer buffer) const override {
+        buffer.WriteU64(static_cast<uint64_t>(m_timeNs));
+        buffer.WriteU32(m_node);
+    }
+
+    void Deserialize(ns3::TagBuffer buffer) override {
+        m_timeNs = static_cast<int64_t>(buffer.ReadU64());
+        m_node = buffer.ReadU32();
+    }
+
+    void Print(std::ostream &os) const override {
+        os << "origin=" << m_node << "@" << m_timeNs << "ns";
+    }
+
+    int64_t GetTimeNs() const {
+        return m_timeNs;
+    }
+
+    uint32_t GetNode() const {
+        return m_node;
+    }
+
+private:
+    int64_t m_timeNs = 0;
+    uint32_t m_node = 0;
+};
+
+// Log-spaced latency histogram, 4 bins per octave from 1 us
+class LatencyHistogram {
+public:
+    static constexpr uint32_t BINS = 112; // up to 2^28 us, about 268 s
+
+    void Add(double seconds) {
+        double us = seconds * 1e6;
+        uint32_t bin = us <= 1.0 ? 0 : static_cast<uint32_t>(std::ceil(4 * std::log2(us)));
+        m_counts[bin < BINS ? bin : BINS - 1]++;
+        m_count++;
+        m_sum += seconds;
+    }
+
+    void Merge(const LatencyHistogram &other) {
+        for (uint32_t bin = 0; bin < BINS; ++bin) {
+            m_counts[bin] += other.m_counts[bin];
+        }
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+    }
+
+    uint64_t GetCount() const {
+        return m_count;
+    }
+
+    double MeanMs() const {
+        return m_count > 0 ? m_sum / m_count * 1000 : 0.0;
+    }
+
+    // Upper edge in ms of the bin holding quantile q
+    double QuantileMs(double q) const {
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * m_count));
+        uint64_t seen = 0;
+        for (uint32_t bin = 0; bin < BINS; ++bin) {
+            seen += m_counts[bin];
+            if (seen >= rank && seen > 0) {
+                return UpperMs(bin);
+            }
+        }
+        return 0.0;
+    }
+
+    static double UpperMs(uint32_t bin) {
+        return std::exp2(bin / 4.0) / 1000;
+    }
+
+    uint64_t GetBin(uint32_t bin) const {
+        return m_counts[bin];
+    }
+
+private:
+    uint64_t m_counts[BINS] = {};
+    uint64_t m_count = 0;
+    double m_sum = 0.0;
+};
+
+class HopLatencyMonitor {
+public:
+    enum Stage { QUEUE, SERIALIZATION, PROPAGATION, SOJOURN, STAGES };
+
+    static const char *StageName(uint32_t stage) {
+        static const char *names[STAGES] = {"queue", "serialization", "propagation", "sojourn"};
+        return names[stage];
+    }
+
+    bool IsEnabled() const {
+        return m_enabled;
+    }
+
+    // Time every device with a channel and every local delivery of all nodes
+    void Install() {
+        m_enabled = true;
+        for (uint32_t n = 0; n < ns3::NodeList::GetNNodes(); ++n) {
+            ns3::Ptr<ns3::Node> node = ns3::NodeList::GetNode(n);
+            for (uint32_t d = 0; d < node->GetNDevices(); ++d) {
+                ns3::Ptr<ns3::NetDevice> device = node->GetDevice(d);
+                if (device->GetChannel()) {
+                    AddPort(device);
+                }
+            }
+            ns3::Ptr<ns3::Ipv4L3Protocol> ipv4 = node->GetObject<ns3::Ipv4L3Protocol>();
+            if (ipv4) {
+                ipv4->TraceConnectWithoutContext("LocalDeliver",
+                                                 ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyDeliver, this, n));
+            }
+        }
+    }
+
+    void WriteReport(const std::string &path) const {
+        if (!m_enabled) {
+            return;
+        }
+        std::ofstream report(path);
+        report << "# hop\tnode\tdevice\tpeer\tpackets\tqueueMeanMs\tqueueP99Ms\tserializationMeanMs"
+                  "\tpropagationMeanMs\tsojournMeanMs\tsojournP50Ms\tsojournP99Ms"
+               << std::endl;
+        for (uint32_t i = 0; i < m_ports.size(); ++i) {
+            const Port &port = m_ports[i];
+            const LatencyHistogram &sojourn = port.stages[SOJOURN];
+            if (sojourn.GetCount() == 0) {
+                continue;
+            }
+            report << i << "\t" << port.node << "\t" << port.device << "\t" << port.peer << "\t" << sojourn.GetCount()
+                   << "\t" << port.stages[QUEUE].MeanMs() << "\t" << port.stages[QUEUE].QuantileMs(0.99) << "\t"
+                   << port.stages[SERIALIZATION].MeanMs() << "\t" << port.stages[PROPAGATION].MeanMs() << "\t"
+                   << sojourn.MeanMs() << "\t" << sojourn.QuantileMs(0.5) << "\t" << sojourn.QuantileMs(0.99)
+                   << std::endl;
+        }
+        report << std::endl;
+        report << "# src\tdst\tpackets\towdMeanMs\towdP50Ms\towdP99Ms\treverseMeanMs\trttMs" << std::endl;
+        for (const auto &entry : m_pairs) {
+            const LatencyHistogram &owd = entry.second;
+            auto reverse = m_pairs.find(std::make_pair(entry.first.second, entry.first.first));
+            report << entry.first.first << "\t" << entry.first.second << "\t" << owd.GetCount() << "\t" << owd.MeanMs()
+                   << "\t" << owd.QuantileMs(0.5) << "\t" << owd.QuantileMs(0.99) << "\t";
+            if (reverse != m_pairs.end()) {
+                report << reverse->second.MeanMs() << "\t" << owd.MeanMs() + reverse->second.MeanMs() << std::endl;
+            } else {
+                report << "-\t-" << std::endl;
+            }
+        }
+    }
+
+    void WriteHistograms(const std::string &path) const {
+        if (!m_enabled) {
+            return;
+        }
+        std::ofstream histograms(path);
+        histograms << "# kind\tid\tstage\tupperMs\tcount" << std::endl;
+        for (uint32_t i = 0; i < m_ports.size(); ++i) {
+            for (uint32_t stage = 0; stage < STAGES; ++stage) {
+                WriteBins(histograms, "hop\t" + std::to_string(i), StageName(stage), m_ports[i].stages[stage]);
+            }
+        }
+        for (const auto &entry : m_pairs) {
+            WriteBins(histograms, "pair\t" + std::to_string(entry.first.first) + "-" + std::to_string(entry.first.second),
+                      "owd", entry.second);
+        }
+    }
+
+private:
+    struct Port {
+        uint32_t node = 0;
+        uint32_t device = 0;
+        int32_t peer = -1;
+        uint32_t channel = 0;
+        std::unordered_map<uint64_t, int64_t> enqueued; // uid -> entry time (ns)
+        std::unordered_map<uint64_t, std::pair<int64_t, int64_t>> sending; // uid -> entry, PhyTxBegin (ns)
+        LatencyHistogram stages[STAGES];
+    };
+
+    struct InFlight {
+        uint32_t port;
+        int64_t txEnd; // ns
+        int64_t entry; // ns, for the sojourn
+    };
+
+    void AddPort(ns3::Ptr<ns3::NetDevice> device) {
+        ns3::Ptr<ns3::Channel> channel = device->GetChannel();
+        uint32_t index = static_cast<uint32_t>(m_ports.size());
+        Port port;
+        port.node = device->GetNode()->GetId();
+        port.device = device->GetIfIndex();
+        if (channel->GetNDevices() == 2) {
+            ns3::Ptr<ns3::NetDevice> other = channel->GetDevice(0) == device ? channel->GetDevice(1) : channel->GetDevice(0);
+            port.peer = static_cast<int32_t>(other->GetNode()->GetId());
+        }
+        auto known = m_channelIds.find(ns3::PeekPointer(channel));
+        if (known == m_channelIds.end()) {
+            known = m_channelIds.emplace(ns3::PeekPointer(channel), static_cast<uint32_t>(m_channels.size())).first;
+            m_channels.emplace_back();
+        }
+        port.channel = known->second;
+        m_ports.push_back(port);
+
+        ns3::Ptr<ns3::TrafficControlLayer> tc = device->GetNode()->GetObject<ns3::TrafficControlLayer>();
+        ns3::Ptr<ns3::QueueDisc> disc;
+        if (tc) {
+            disc = tc->GetRootQueueDiscOnDevice(device);
+        }
+        if (disc) {
+            disc->TraceConnectWithoutContext("Enqueue",
+                                             ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyDiscEnqueue, this, index));
+            disc->TraceConnectWithoutContext("Drop",
+                                             ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyDiscDrop, this, index));
+        }
+        device->TraceConnectWithoutContext("MacTx", ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyEnqueue, this, index));
+        device->TraceConnectWithoutContext("MacTxDrop", ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyDrop, this, index));
+        device->TraceConnectWithoutContext("PhyTxBegin",
+                                           ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyTxBegin, this, index));
+        device->TraceConnectWithoutContext("PhyTxEnd", ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyTxEnd, this, index));
+        device->TraceConnectWithoutContext("PhyRxEnd", ns3::MakeBoundCallback(&HopLatencyMonitor::NotifyRxEnd, this, index));
+    }
+
+    static void NotifyEnqueue(HopLatencyMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::Packet> packet) {
+        int64_t now = ns3::Simulator::Now().GetNanoSeconds();
+        // The first of queue disc and device enqueue counts
+        monitor->m_ports[index].enqueued.emplace(packet->GetUid(), now);
+        HopOriginTag origin;
+        if (!packet->PeekPacketTag(origin)) {
+            packet->AddPacketTag(HopOriginTag(now, monitor->m_ports[index].node));
+        }
+    }
+
+    static void NotifyDiscEnqueue(HopLatencyMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::QueueDiscItem> item) {
+        NotifyEnqueue(monitor, index, item->GetPacket());
+    }
+
+    static void NotifyDrop(HopLatencyMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::Packet> packet) {
+        monitor->m_ports[index].enqueued.erase(packet->GetUid());
+    }
+
+    static void NotifyDiscDrop(HopLatencyMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::QueueDiscItem> item) {
+        NotifyDrop(monitor, index, item->GetPacket());
+    }
+
+    static void NotifyTxBegin(HopLatencyMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::Packet> packet) {
+        Port &port = monitor->m_ports[index];
+        int64_t now = ns3::Simulator::Now().GetNanoSeconds();
+        auto entry = port.enqueued.find(packet->GetUid());
+        int64_t entered = now;
+        if (entry != port.enqueued.end()) {
+            entered = entry->second;
+            port.enqueued.erase(entry);
+        }
+        port.stages[QUEUE].Add((now - entered) / 1e9);
+        port.sending[packet->GetUid()] = std::make_pair(entered, now);
+    }
+
+    static void NotifyTxEnd(HopLatencyMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::Packet> packet) {
+        Port &port = monitor->m_ports[index];
+        auto begin = port.sending.find(packet->GetUid());
+        if (begin == port.sending.end()) {
+            return;
+        }
+        int64_t now = ns3::Simulator::Now().GetNanoSeconds();
+        port.stages[SERIALIZATION].Add((now - begin->second.second) / 1e9);
+        monitor->m_channels[port.channel][packet->GetUid()] = InFlight{index, now, begin->second.first};
+        port.sending.erase(begin);
+    }
+
+    static void NotifyRxEnd(HopLatencyMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::Packet> packet) {
+        auto &inFlight = monitor->m_channels[monitor->m_ports[index].channel];
+        auto sent = inFlight.find(packet->GetUid());
+        if (sent == inFlight.end()) {
+            return;
+        }
+        int64_t now = ns3::Simulator::Now().GetNanoSeconds();
+        Port &port = monitor->m_ports[sent->second.port];
+        port.stages[PROPAGATION].Add((now - sent->second.txEnd) / 1e9);
+        port.stages[SOJOURN].Add((now - sent->second.entry) / 1e9);
+        inFlight.erase(sent);
+    }
+
+    static void NotifyDeliver(HopLatencyMonitor *monitor, uint32_t node, const ns3::Ipv4Header &,
+                              ns3::Ptr<const ns3::Packet> packet, uint32_t) {
+        HopOriginTag origin;
+        if (!packet->PeekPacketTag(origin) || origin.GetNode() == node) {
+            return;
+        }
+        double delay = (ns3::Simulator::Now().GetNanoSeconds() - origin.GetTimeNs()) / 1e9;
+        monitor->m_pairs[std::make_pair(origin.GetNode(), node)].Add(delay);
+    }
+
+    static void WriteBins(std::ofstream &out, const std::string &id, const char *stage,
+                          const LatencyHistogram &histogram) {
+        for (uint32_t bin = 0; bin < LatencyHistogram::BINS; ++bin) {
+            if (histogram.GetBin(bin) > 0) {
+                out << id << "\t" << stage << "\t" << LatencyHistogram::UpperMs(bin) << "\t" << histogram.GetBin(bin)
+                    << "\n";
+            }
+        }
+    }
+
+    bool m_enabled = false;
+    std::vector<Port> m_ports;
+    std::map<const ns3::Channel *, uint32_t> m_channelIds;
+    std::vector<std::unordered_map<uint64_t, InFlight>> m_channels;
+    std::map<std::pair<uint32_t, uint32_t>, LatencyHistogram> m_pairs;
+};
+
+#endif // HOP_LATENCY_H
@@ -0,0 +1,268 @@
+/*
+===================================================================
+    Dynamic Link Events
+===================================================================
+
+    Scenario timeline that changes link parameters while the
+    simulation runs and measures how fast throughput re-converges
+    after each change.
+
+    Links are numbered in the order the scenario registers them with
+    AddLink(). Events (--linkEvents) are separated by ';', each one is
+    <time>:<action>:<link>[:<value>]:
+
+      10s:rate:1:2Mbps     set the link DataRate
+      20s:delay:1:50ms     set the channel propagation Delay
+      30s:down:2           take both interfaces of the link down
+      40s:up:2             bring them back up
+      45s:reroute          recompute the routing tables only
+
+    down/up/reroute trigger a routing recomputation. After every event
+    the throughput samples are fed into a sliding window; the flow is
+    considered recovered once the coefficient of variation over the
+    window falls below the tolerance. The report lists, per event,
+    the mean throughput before it, the recovery time and the settled
+    throughput.
+
+===================================================================
+*/
+
+#ifndef LINK_EVENTS_H
+#define LINK_EVENTS_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "steady-state-monitor.h"
+
+class LinkEventTimeline {
+public:
+    LinkEventTimeline() : m_recompute(&ns3::Ipv4GlobalRoutingHelper::RecomputeRoutingTables) {}
+
+    // Register the devices of one link (both ends of a point-to-point link, every device of a bus)
+    uint32_t AddLink(const ns3::NetDeviceContainer &devices) {
+        m_links.push_back(devices);
+        return m_links.size() - 1;
+    }
+
+    // Routing recomputation used by down/up/reroute (global routing by default)
+    void SetRecomputeCallback(std::function<void()> recompute) {
+        m_recompute = recompute;
+    }
+
+    void SetRecoveryCriterion(double window, double tolerance) {
+        m_window = window;
+        m_tolerance = tolerance;
+    }
+
+    bool IsEnabled() const {
+        return !m_events.empty();
+    }
+
+    // Parse the event list and schedule every event; malformed entries are reported and skipped
+    void Schedule(const std::string &spec) {
+        std::stringstream entries(spec);
+        std::string entry;
+        while (std::getline(entries, entry, ';')) {
+            std::vector<std::string> fields;
+            std::stringstream parts(entry);
+            std::string field;
+            while (std::getline(parts, field, ':')) {
+                fields.push_back(field);
+            }
+            if (fields.size() < 2) {
+                continue;
+            }
+            Event event;
+            event.action = fields[1];
+            event.value = fields.size() > 3 ? fields[3] : "";
+            if (!IsTime(fields[0])) {
+                std::cerr << "Link event '" << entry << "' has an invalid time" << std::endl;
+                continue;
+            }
+            event.time = ns3::Time(fields[0]);
+            if (event.action != "rate" && event.action != "delay" && event.action != "down" &&
+                event.action != "up" && event.action != "reroute") {
+                std::cerr << "Link event '" << entry << "' has unknown action '" << event.action << "'" << std::endl;
+                continue;
+            }
+            if (fields.size() > 2 && !ParseLink(fields[2], event.link)) {
+                std::cerr << "Link event '" << entry << "' has an invalid link number" << std::endl;
+                continue;
+            }
+            if (event.action != "reroute" && fields.size() < 3) {
+                std::cerr << "Link event '" << entry << "' needs a link number" << std::endl;
+                continue;
+            }
+            if ((event.action == "rate" || event.action == "delay") && event.value.empty()) {
+                std::cerr << "Link event '" << entry << "' needs a value" << std::endl;
+                continue;
+            }
+            if (event.action == "delay" && !IsTime(event.value)) {
+                std::cerr << "Link event '" << entry << "' has an invalid delay" << std::endl;
+                continue;
+            }
+            if (event.action == "rate" && !IsDataRate(event.value)) {
+                std::cerr << "Link event '" << entry << "' has an invalid rate" << std::endl;
+                continue;
+            }
+            if (event.action != "reroute" && event.link >= m_links.size()) {
+                std::cerr << "Link event '" << entry << "' refers to unknown link " << event.link << std::endl;
+                continue;
+            }
+            m_events.push_back(event);
+            ns3::Simulator::Schedule(event.time, &LinkEventTimeline::Apply, this,
+                                     static_cast<uint32_t>(m_events.size() - 1));
+        }
+    }
+
+    // Feed the scenario's throughput sample (Mbps) taken at the current time
+    void AddThroughputSample(double throughput) {
+        if (m_events.empty()) {
+            return;
+        }
+        double now = ns3::Simulator::Now().GetSeconds();
+        m_history.Add(now, throughput);
+        if (m_tracking < 0) {
+            return;
+        }
+        Event &event = m_events[m_tracking];
+        m_recovery.Add(now, throughput);
+        if (m_recovery.IsFull() && m_recovery.Cv() <= m_tolerance) {
+            event.recoveredAt = now;
+            event.recoveryTime = std::max(0.0, now - m_window - event.time.GetSeconds());
+            event.settledThroughput = m_recovery.Mean();
+            std::cout << "Throughput re-converged " << event.recoveryTime << " s after the " << event.action
+                      << " event at " << event.time.GetSeconds() << " s" << std::endl;
+            m_tracking = -1;
+        }
+    }
+
+    // One line per event: time action link value preEventMbps recoveryTime settledMbps
+    void WriteReport(const std::string &path) const {
+        if (m_events.empty()) {
+            return;
+        }
+        std::ofstream report(path);
+        report << "# time\taction\tlink\tvalue\tpreEventMbps\trecoveryTime\tsettledMbps" << std::endl;
+        for (const Event &event : m_events) {
+            report << event.time.GetSeconds() << "\t" << event.action << "\t" << event.link << "\t"
+                   << (event.value.empty() ? "-" : event.value) << "\t" << event.preEventThroughput << "\t"
+                   << event.recoveryTime << "\t" << event.settledThroughput << std::endl;
+        }
+    }
+
+private:
+    struct Event {
+        ns3::Time time;
+        std::string action;
+        uint32_t link = 0;
+        std::string value;
+        double preEventThroughput = 0.0;
+        double recoveredAt = -1.0;
+        double recoveryTime = -1.0; // -1: not recovered before the next event or the end of the run
+        double settledThroughput = 0.0;
+    };
+
+    // A non-negative number with an optional ns3::Time unit, e.g. "10s", "2.5ms"
+    static bool IsTime(const std::string &text) {
+        char *end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (end == text.c_str() || !std::isfinite(value) || value < 0.0) {
+            return false;
+        }
+        static const char *const units[] = {"", "s", "ms", "us", "ns", "ps", "fs", "min", "h", "d", "y"};
+        for (const char *unit : units) {
+            if (std::string(end) == unit) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // A DataRate attribute string, e.g. "2Mbps"; ns-3 aborts on malformed ones when they are set
+    static bool IsDataRate(const std::string &text) {
+        ns3::DataRateValue rate;
+        return rate.DeserializeFromString(text, ns3::MakeDataRateChecker());
+    }
+
+    static bool ParseLink(const std::string &text, uint32_t &link) {
+        char *end = nullptr;
+        errno = 0;
+        unsigned long value = std::strtoul(text.c_str(), &end, 10);
+        if (text.empty() || text[0] == '-' || *end != '\0' || errno == ERANGE || value > UINT32_MAX) {
+            return false;
+        }
+        link = static_cast<uint32_t>(value);
+        return true;
+    }
+
+    void Apply(uint32_t index) {
+        Event &event = m_events[index];
+        bool reroute = false;
+        if (event.action == "rate") {
+            for (uint32_t i = 0; i < m_links[event.link].GetN(); ++i) {
+                ns3::Ptr<ns3::NetDevice> device = m_links[event.link].Get(i);
+                // PointToPoint devices own their rate, CSMA keeps it on the channel
+                ns3::TypeId::AttributeInformation info;
+                if (device->GetInstanceTypeId().LookupAttributeByName("DataRate", &info)) {
+                    device->SetAttribute("DataRate", ns3::StringValue(event.value));
+                } else {
+                    device->GetChannel()->SetAttribute("DataRate", ns3::StringValue(event.value));
+                }
+            }
+        } else if (event.action == "delay") {
+            m_links[event.link].Get(0)->GetChannel()->SetAttribute("Delay", ns3::StringValue(event.value));
+        } else if (event.action == "down" || event.action == "up") {
+            for (uint32_t i = 0; i < m_links[event.link].GetN(); ++i) {
+                ns3::Ptr<ns3::NetDevice> device = m_links[event.link].Get(i);
+                ns3::Ptr<ns3::Ipv4> ipv4 = device->GetNode()->GetObject<ns3::Ipv4>();
+                int32_t interface = ipv4->GetInterfaceForDevice(device);
+                if (interface < 0) {
+                    continue;
+                }
+                if (event.action == "down") {
+                    ipv4->SetDown(interface);
+                } else {
+                    ipv4->SetUp(interface);
+                }
+            }
+            reroute = true;
+        } else {
+            reroute = true; // "reroute"; Schedule() accepts no other action
+        }
+        if (reroute) {
+            m_recompute();
+        }
+        std::cout << "Link event at " << event.time.GetSeconds() << " s: " << event.action << " link "
+                  << event.link << (event.value.empty() ? "" : " -> " + event.value) << std::endl;
+
+        // Start measuring re-convergence from this event on
+        event.preEventThroughput = m_history.Mean();
+        m_recovery.SetWindow(m_window);
+        m_recovery.Clear();
+        m_tracking = static_cast<int32_t>(index);
+    }
+
+    std::vector<ns3::NetDeviceContainer> m_links;
+    std::vector<Event> m_events;
+    std::function<void()> m_recompute;
+    double m_window = 5.0;
+    double m_tolerance = 0.1;
+    WindowedCv m_history{5.0};  // throughput just before an event
+    WindowedCv m_recovery;
+    int32_t m_tracking = -1;
+};
+
+#endif // LINK_EVENTS_H
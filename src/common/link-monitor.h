@@ -0,0 +1,240 @@
+/*
+===================================================================
+    Per-Link Utilization and Queue Monitor
+===================================================================
+
+    Samples every registered NetDevice (one transmit direction of a
+    link) at a fixed period:
+
+      txBytes       bytes put on the wire so far
+      utilization   bits sent during the period / (period * DataRate)
+      queuePackets  packets waiting in the device queue plus the
+      queueBytes    traffic-control queue disc of that device
+      drops         packets dropped by both queues so far
+
+    One row per device and sample with the columns
+        time  link  node  peer  txBytes  utilization  queuePackets
+        queueBytes  drops
+    (peer is -1 on shared channels such as the CSMA bus), written
+    either to a single columnar file (columnar-writer.h, default) or
+    as tab-separated text.
+
+    The hotspot report ranks the devices by mean utilization and
+    lists peak utilization, mean/peak queue and drops, so idle
+    redundant links and saturated ones stand out.
+
+===================================================================
+*/
+
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+#include "columnar-writer.h"
+
+class LinkMonitor {
+public:
+    // Register the devices of one link; returns its index (same numbering as LinkEventTimeline)
+    uint32_t AddLink(const ns3::NetDeviceContainer &devices) {
+        uint32_t link = m_links++;
+        for (uint32_t i = 0; i < devices.GetN(); ++i) {
+            Port port;
+            port.device = devices.Get(i);
+            port.link = link;
+            port.node = port.device->GetNode()->GetId();
+            ns3::Ptr<ns3::Channel> channel = port.device->GetChannel();
+            if (channel && channel->GetNDevices() == 2) {
+                ns3::Ptr<ns3::NetDevice> other = channel->GetDevice(0) == port.device ? channel->GetDevice(1)
+                                                                                      : channel->GetDevice(0);
+                port.peer = static_cast<int32_t>(other->GetNode()->GetId());
+            }
+            m_ports.push_back(port);
+        }
+        return link;
+    }
+
+    bool IsEnabled() const {
+        return m_period > 0.0;
+    }
+
+    // Start sampling every `period`, writing the series to `path` (columnar or text)
+    void Start(ns3::Time period, const std::string &path, bool columnar = true) {
+        m_period = period.GetSeconds();
+        m_columnar = columnar;
+        for (uint32_t i = 0; i < m_ports.size(); ++i) {
+            m_ports[i].device->TraceConnectWithoutContext("PhyTxEnd",
+                                                          ns3::MakeBoundCallback(&LinkMonitor::NotifyTx, this, i));
+        }
+        if (m_columnar) {
+            m_columns.AddSeries("links");
+            m_columns.AddColumn(0, "time", COLUMN_TIME);
+            m_columns.AddColumn(0, "link", COLUMN_I64);
+            m_columns.AddColumn(0, "node", COLUMN_I64);
+            m_columns.AddColumn(0, "peer", COLUMN_I64);
+            m_columns.AddColumn(0, "txBytes", COLUMN_I64);
+            m_columns.AddColumn(0, "utilization", COLUMN_F64);
+            m_columns.AddColumn(0, "queuePackets", COLUMN_I64);
+            m_columns.AddColumn(0, "queueBytes", COLUMN_I64);
+            m_columns.AddColumn(0, "drops", COLUMN_I64);
+            m_columns.SetAttribute("source", "LinkMonitor");
+            m_columns.SetAttribute("period", std::to_string(m_period));
+            m_columns.SetAttribute("devices", std::to_string(m_ports.size()));
+            m_columns.Open(path);
+        } else {
+            m_series.open(path);
+            m_series << "# time\tlink\tnode\tpeer\ttxBytes\tutilization\tqueuePackets\tqueueBytes\tdrops" << std::endl;
+        }
+        ns3::Simulator::Schedule(period, &LinkMonitor::Sample, this);
+    }
+
+    // Series stream, e.g. for SnapshotBrancher::AddOutput
+    std::ofstream &GetSeriesStream() {
+        return m_columnar ? m_columns.GetStream() : m_series;
+    }
+
+    // Flush buffered rows and close the series
+    void Close() {
+        m_columns.Close();
+        m_series.close();
+    }
+
+    // Devices ranked by mean utilization
+    void WriteHotspotReport(const std::string &path) const {
+        if (!IsEnabled()) {
+            return;
+        }
+        std::vector<const Port *> ranked;
+        for (const Port &port : m_ports) {
+            ranked.push_back(&port);
+        }
+        std::stable_sort(ranked.begin(), ranked.end(), [](const Port *a, const Port *b) {
+            return a->MeanUtilization() > b->MeanUtilization();
+        });
+
+        uint32_t active = 0;
+        for (const Port *port : ranked) {
+            active += port->MeanUtilization() > 0.01 ? 1 : 0;
+        }
+        std::ofstream report(path);
+        report << "# " << active << " of " << ranked.size() << " link directions carried traffic (>1% mean utilization)"
+               << std::endl;
+        report << "# rank\tlink\tnode\tpeer\tmeanUtil\tmaxUtil\tmeanQueue\tmaxQueue\tdrops" << std::endl;
+        for (uint32_t i = 0; i < ranked.size(); ++i) {
+            const Port &port = *ranked[i];
+            report << i + 1 << "\t" << port.link << "\t" << port.node << "\t" << port.peer << "\t"
+                   << port.MeanUtilization() << "\t" << port.maxUtilization << "\t"
+                   << (port.samples > 0 ? port.queueSum / port.samples : 0.0) << "\t" << port.maxQueue << "\t"
+                   << port.drops << std::endl;
+        }
+    }
+
+private:
+    struct Port {
+        ns3::Ptr<ns3::NetDevice> device;
+        uint32_t link = 0;
+        uint32_t node = 0;
+        int32_t peer = -1;
+        uint64_t txBytes = 0;      // total
+        uint64_t lastTxBytes = 0;  // at the previous sample
+        uint32_t samples = 0;
+        double utilizationSum = 0.0;
+        double maxUtilization = 0.0;
+        double queueSum = 0.0;
+        uint32_t maxQueue = 0;
+        uint64_t drops = 0;
+
+        double MeanUtilization() const {
+            return samples > 0 ? utilizationSum / samples : 0.0;
+        }
+    };
+
+    static void NotifyTx(LinkMonitor *monitor, uint32_t index, ns3::Ptr<const ns3::Packet> packet) {
+        monitor->m_ports[index].txBytes += packet->GetSize();
+    }
+
+    // Device DataRate, or the channel's for CSMA where the rate lives on the channel
+    static double DataRateBps(ns3::Ptr<ns3::NetDevice> device) {
+        ns3::DataRateValue rate;
+        if (device->GetAttributeFailSafe("DataRate", rate) ||
+            (device->GetChannel() && device->GetChannel()->GetAttributeFailSafe("DataRate", rate))) {
+            return static_cast<double>(rate.Get().GetBitRate());
+        }
+        return 0.0;
+    }
+
+    static void QueueState(ns3::Ptr<ns3::NetDevice> device, uint32_t &packets, uint64_t &bytes, uint64_t &drops) {
+        packets = 0;
+        bytes = 0;
+        drops = 0;
+        ns3::PointerValue pointer;
+        if (device->GetAttributeFailSafe("TxQueue", pointer)) {
+            ns3::Ptr<ns3::QueueBase> queue = pointer.Get<ns3::QueueBase>();
+            if (queue) {
+                packets += queue->GetNPackets();
+                bytes += queue->GetNBytes();
+                drops += queue->GetTotalDroppedPackets();
+            }
+        }
+        ns3::Ptr<ns3::TrafficControlLayer> tc = device->GetNode()->GetObject<ns3::TrafficControlLayer>();
+        ns3::Ptr<ns3::QueueDisc> disc;
+        if (tc) {
+            disc = tc->GetRootQueueDiscOnDevice(device);
+        }
+        if (disc) {
+            packets += disc->GetNPackets();
+            bytes += disc->GetNBytes();
+            drops += disc->GetStats().nTotalDroppedPackets;
+        }
+    }
+
+    void Sample() {
+        double now = ns3::Simulator::Now().GetSeconds();
+        for (Port &port : m_ports) {
+            double rate = DataRateBps(port.device);
+            double utilization = rate > 0 ? ((port.txBytes - port.lastTxBytes) * 8.0) / (m_period * rate) : 0.0;
+            port.lastTxBytes = port.txBytes;
+            uint32_t queued = 0;
+            uint64_t queuedBytes = 0;
+            QueueState(port.device, queued, queuedBytes, port.drops);
+
+            port.samples++;
+            port.utilizationSum += utilization;
+            port.maxUtilization = std::max(port.maxUtilization, utilization);
+            port.queueSum += queued;
+            port.maxQueue = std::max(port.maxQueue, queued);
+
+            if (m_columnar) {
+                m_columns.Append(0, 0, now);
+                m_columns.Append(0, 1, static_cast<int64_t>(port.link));
+                m_columns.Append(0, 2, static_cast<int64_t>(port.node));
+                m_columns.Append(0, 3, static_cast<int64_t>(port.peer));
+                m_columns.Append(0, 4, static_cast<int64_t>(port.txBytes));
+                m_columns.Append(0, 5, utilization);
+                m_columns.Append(0, 6, static_cast<int64_t>(queued));
+                m_columns.Append(0, 7, static_cast<int64_t>(queuedBytes));
+                m_columns.Append(0, 8, static_cast<int64_t>(port.drops));
+                m_columns.EndRow(0);
+            } else {
+                m_series << now << "\t" << port.link << "\t" << port.node << "\t" << port.peer << "\t" << port.txBytes
+                         << "\t" << utilization << "\t" << queued << "\t" << queuedBytes << "\t" << port.drops << "\n";
+            }
+        }
+        ns3::Simulator::Schedule(ns3::Seconds(m_period), &LinkMonitor::Sample, this);
+    }
+
+    uint32_t m_links = 0;
+    std::vector<Port> m_ports;
+    double m_period = 0.0;
+    bool m_columnar = true;
+    ColumnarWriter m_columns;
+    std::ofstream m_series;
+};
+
+#endif // LINK_MONITOR_H
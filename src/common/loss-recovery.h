@@ -0,0 +1,250 @@
+/*
+===================================================================
+    Loss-Recovery Statistics
+===================================================================
+
+    Counts what loss recovery costs per flow, which the "Packet Loss"
+    column (sent minus received application packets) hides:
+
+      sentBytes         payload bytes handed to the network
+      retxBytes         payload bytes sent again (TCP) or carried by
+                        packets declared lost (QUIC, whose frames are
+                        resent in new packets)
+      wastedPct         retxBytes / sentBytes
+      retransmits       retransmitted segments / lost packets
+      fastRetransmits   recovery episodes entered on duplicate ACKs
+      timeouts          RTO (TCP) or PTO (QUIC) expiries
+      spuriousBytes     payload a TCP receiver got twice
+      spuriousTimeouts  QUIC PTOs never verified by a later ACK
+
+    TCP (Attach, a SocketRegistry hook): a data segment below the
+    highest sequence sent is a retransmission; CongState entering
+    CA_RECOVERY is a fast retransmit and CA_LOSS a timeout. Accepted
+    sockets count received payload that was already there, so
+    spurious retransmissions show up on the receiving flow.
+
+    QUIC: TracedQuicBbr (bbr-tracer.h) reports OnPacketsLost,
+    OnRetransmissionTimeout and OnRetransmissionTimeoutVerified of
+    its controller; sentBytes are the acknowledged plus the lost
+    bytes. Flow ids are the controller ids of bbr-tracer.h.
+
+    Every event is one tab-separated row of <prefix>.recovery, and of
+    a "recovery" series of the columnar file:
+
+      # time flow event bytes
+
+    with event retx, lost, fastretx, rto, pto, ptoverified or
+    spurious. WriteReport() writes the per-flow totals above.
+
+===================================================================
+*/
+
+#ifndef LOSS_RECOVERY_H
+#define LOSS_RECOVERY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "metric-store.h"
+
+class LossRecoveryStats {
+public:
+    enum Event { RETX, LOST, FAST_RETX, RTO, PTO, PTO_VERIFIED, SPURIOUS, EVENTS };
+
+    static LossRecoveryStats &Instance() {
+        static LossRecoveryStats stats;
+        return stats;
+    }
+
+    static const char *EventName(Event event) {
+        static const char *names[EVENTS] = {"retx", "lost", "fastretx", "rto", "pto", "ptoverified", "spurious"};
+        return names[event];
+    }
+
+    // Declares the columnar series, so call before MetricStore::Open()
+    void Configure(MetricStore &metrics) {
+        m_metrics = &metrics;
+        m_series = metrics.AddSeries("recovery", {"flow", "event", "bytes"});
+    }
+
+    bool IsEnabled() const {
+        return m_metrics != nullptr;
+    }
+
+    void Start(const std::string &path) {
+        m_stream.open(path);
+        m_stream << "# time\tflow\tevent\tbytes" << std::endl;
+    }
+
+    std::ofstream &GetStream() {
+        return m_stream;
+    }
+
+    // SocketRegistry hook
+    static void Attach(uint32_t flow, ns3::Ptr<ns3::TcpSocketBase> socket) {
+        LossRecoveryStats &stats = Instance();
+        stats.GetFlow(flow);
+        socket->TraceConnectWithoutContext("Tx", ns3::MakeBoundCallback(&LossRecoveryStats::NotifyTcpTx, flow));
+        socket->TraceConnectWithoutContext("Rx", ns3::MakeBoundCallback(&LossRecoveryStats::NotifyTcpRx, flow));
+        socket->TraceConnectWithoutContext("CongState",
+                                           ns3::MakeBoundCallback(&LossRecoveryStats::NotifyCongState, flow));
+    }
+
+    void AddSent(uint32_t flow, uint64_t bytes) {
+        GetFlow(flow).sentBytes += bytes;
+    }
+
+    void Record(uint32_t flow, Event event, uint64_t bytes) {
+        Flow &f = GetFlow(flow);
+        f.events[event]++;
+        switch (event) {
+        case RETX:
+        case LOST:
+            f.retxBytes += bytes;
+            break;
+        case SPURIOUS:
+            f.spuriousBytes += bytes;
+            break;
+        default:
+            break;
+        }
+        double now = ns3::Simulator::Now().GetSeconds();
+        m_stream << now << "\t" << flow << "\t" << EventName(event) << "\t" << bytes << "\n";
+        m_metrics->RecordRow(m_series, now,
+                             {static_cast<double>(flow), static_cast<double>(event), static_cast<double>(bytes)});
+    }
+
+    // Per-flow totals; flows without any traffic are left out
+    void WriteReport(const std::string &path) {
+        if (!IsEnabled()) {
+            return;
+        }
+        std::ofstream report(path);
+        report << "# flow\tsentBytes\tretxBytes\twastedPct\tretransmits\tfastRetransmits\ttimeouts\tspuriousBytes"
+                  "\tspuriousTimeouts"
+               << std::endl;
+        for (uint32_t i = 0; i < m_flows.size(); ++i) {
+            const Flow &f = m_flows[i];
+            if (f.sentBytes == 0 && f.received.empty()) {
+                continue;
+            }
+            uint64_t timeouts = f.events[RTO] + f.events[PTO];
+            uint64_t verified = std::min(f.events[PTO], f.events[PTO_VERIFIED]);
+            report << i << "\t" << f.sentBytes << "\t" << f.retxBytes << "\t"
+                   << (f.sentBytes > 0 ? 100.0 * f.retxBytes / f.sentBytes : 0.0) << "\t"
+                   << f.events[RETX] + f.events[LOST] << "\t" << f.events[FAST_RETX] << "\t" << timeouts << "\t"
+                   << f.spuriousBytes << "\t" << f.events[PTO] - verified << std::endl;
+        }
+    }
+
+    void Close() {
+        if (m_stream.is_open()) {
+            m_stream.close();
+        }
+    }
+
+private:
+    struct Flow {
+        uint64_t sentBytes = 0;
+        uint64_t retxBytes = 0;
+        uint64_t spuriousBytes = 0;
+        uint64_t events[EVENTS] = {};
+        // Sender: end of the highest segment sent
+        bool sending = false;
+        uint32_t highestTx = 0;
+        // Receiver: payload ranges [start, end) received, sequence numbers unwrapped to 64 bits
+        bool receiving = false;
+        uint32_t lastRxRaw = 0;
+        uint64_t lastRx = 0;
+        std::map<uint64_t, uint64_t> received;
+    };
+
+    LossRecoveryStats() = default;
+
+    Flow &GetFlow(uint32_t flow) {
+        if (flow >= m_flows.size()) {
+            m_flows.resize(flow + 1);
+        }
+        return m_flows[flow];
+    }
+
+    static void NotifyTcpTx(uint32_t flow, ns3::Ptr<const ns3::Packet> packet, const ns3::TcpHeader &header,
+                            ns3::Ptr<const ns3::TcpSocketBase>) {
+        uint32_t bytes = packet->GetSize();
+        if (bytes == 0) {
+            return;
+        }
+        LossRecoveryStats &stats = Instance();
+        Flow &f = stats.GetFlow(flow);
+        uint32_t seq = header.GetSequenceNumber().GetValue();
+        f.sentBytes += bytes;
+        if (f.sending && static_cast<int32_t>(seq - f.highestTx) < 0) {
+            stats.Record(flow, RETX, bytes);
+        }
+        if (!f.sending || static_cast<int32_t>(seq + bytes - f.highestTx) > 0) {
+            f.highestTx = seq + bytes;
+        }
+        f.sending = true;
+    }
+
+    static void NotifyTcpRx(uint32_t flow, ns3::Ptr<const ns3::Packet> packet, const ns3::TcpHeader &header,
+                            ns3::Ptr<const ns3::TcpSocketBase>) {
+        uint32_t bytes = packet->GetSize();
+        if (bytes == 0) {
+            return;
+        }
+        LossRecoveryStats &stats = Instance();
+        Flow &f = stats.GetFlow(flow);
+        uint32_t raw = header.GetSequenceNumber().GetValue();
+        uint64_t start = f.receiving ? f.lastRx + static_cast<int32_t>(raw - f.lastRxRaw) : (uint64_t(1) << 32);
+        f.receiving = true;
+        f.lastRxRaw = raw;
+        f.lastRx = start;
+        uint64_t duplicate = Insert(f.received, start, start + bytes);
+        if (duplicate > 0) {
+            stats.Record(flow, SPURIOUS, duplicate);
+        }
+    }
+
+    static void NotifyCongState(uint32_t flow, ns3::TcpSocketState::TcpCongState_t oldState,
+                                ns3::TcpSocketState::TcpCongState_t newState) {
+        if (newState == oldState) {
+            return;
+        }
+        if (newState == ns3::TcpSocketState::CA_RECOVERY) {
+            Instance().Record(flow, FAST_RETX, 0);
+        } else if (newState == ns3::TcpSocketState::CA_LOSS) {
+            Instance().Record(flow, RTO, 0);
+        }
+    }
+
+    // Add [start, end) to `ranges`; returns the bytes that were already covered
+    static uint64_t Insert(std::map<uint64_t, uint64_t> &ranges, uint64_t start, uint64_t end) {
+        uint64_t covered = 0;
+        auto it = ranges.upper_bound(start);
+        if (it != ranges.begin() && std::prev(it)->second >= start) {
+            --it;
+        }
+        while (it != ranges.end() && it->first <= end) {
+            covered += std::min(end, it->second) - std::max(start, it->first);
+            start = std::min(start, it->first);
+            end = std::max(end, it->second);
+            it = ranges.erase(it);
+        }
+        ranges.emplace(start, end);
+        return covered;
+    }
+
+    MetricStore *m_metrics = nullptr;
+    uint32_t m_series = 0;
+    std::ofstream m_stream;
+    std::vector<Flow> m_flows;
+};
+
+#endif // LOSS_RECOVERY_H
@@ -0,0 +1,152 @@
+/*
+===================================================================
+    Metric Store
+===================================================================
+
+    Single entry point for the sampled cwnd, RTT, throughput and
+    packet-loss values. Every sample is forwarded to the replication
+    driver and, with --outputFormat=columnar, appended to one
+    <prefix>.ncol file (columnar-writer.h) that replaces the four text
+    files. Each metric is a series with a delta-encoded time column
+    and an XOR-compressed value column. The header records the program,
+    topology, duration, RNG seed/run and the full command line.
+
+    RecordFlowThroughput() adds a "flowThroughput" series (time,
+    flow, value) with the goodput of every flow of the sink in Mbps,
+    so per-flow questions can be asked of the file, e.g.
+      trace-query f.ncol --series=flowThroughput --by=flow --from=20
+    It is columnar only; the text files keep the aggregate.
+
+    Helpers with multi-column samples (e.g. bbr-tracer.h) declare
+    their own series with AddSeries() and write them with RecordRow();
+    those rows only go to the columnar file.
+
+    The text files stay the default; with the columnar format they
+    are opened on /dev/null (TextPath), the same way replication
+    children discard them.
+
+    Read the file back with columnar-reader.h or src/tools.
+
+===================================================================
+*/
+
+#ifndef METRIC_STORE_H
+#define METRIC_STORE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "columnar-writer.h"
+#include "replication.h"
+
+class MetricStore {
+public:
+    explicit MetricStore(ReplicationRunner &replication) : m_replication(replication) {
+        for (uint32_t metric = 0; metric < METRIC_COUNT; ++metric) {
+            uint32_t series = m_writer.AddSeries(ReplicatedMetricName(metric));
+            m_writer.AddColumn(series, "time", COLUMN_TIME);
+            m_writer.AddColumn(series, "value", COLUMN_F64);
+        }
+        m_flowSeries = AddSeries("flowThroughput", {"flow", "value"});
+    }
+
+    // Extra series with a time column and `columns`, e.g. a controller trace; declare before Open()
+    uint32_t AddSeries(const std::string &name, const std::vector<std::string> &columns) {
+        uint32_t series = m_writer.AddSeries(name);
+        m_writer.AddColumn(series, "time", COLUMN_TIME);
+        for (const std::string &column : columns) {
+            m_writer.AddColumn(series, column, COLUMN_F64);
+        }
+        return series;
+    }
+
+    // Write the metrics to `path` in the columnar format instead of the text files
+    bool Open(const std::string &path, const std::string &program, const std::string &topology, double duration,
+              int argc, char *argv[]) {
+        std::string commandLine;
+        for (int i = 0; i < argc; ++i) {
+            commandLine += (i > 0 ? " " : "") + std::string(argv[i]);
+        }
+        m_writer.SetAttribute("program", program);
+        m_writer.SetAttribute("topology", topology);
+        m_writer.SetAttribute("duration", std::to_string(duration));
+        m_writer.SetAttribute("rngSeed", std::to_string(ns3::RngSeedManager::GetSeed()));
+        m_writer.SetAttribute("rngRun", std::to_string(ns3::RngSeedManager::GetRun()));
+        m_writer.SetAttribute("commandLine", commandLine);
+        m_enabled = m_writer.Open(path);
+        return m_enabled;
+    }
+
+    bool IsEnabled() const {
+        return m_enabled;
+    }
+
+    // Text series are discarded once the columnar file replaces them
+    std::string TextPath(const std::string &path) const {
+        return m_enabled ? "/dev/null" : path;
+    }
+
+    std::ofstream &GetStream() {
+        return m_writer.GetStream();
+    }
+
+    void Record(uint32_t metric, double time, double value) {
+        m_replication.Record(metric, time, value);
+        if (!m_enabled) {
+            return;
+        }
+        m_writer.Append(metric, 0, time);
+        m_writer.Append(metric, 1, value);
+        m_writer.EndRow(metric);
+    }
+
+    // One row of an AddSeries() series; not replicated
+    void RecordRow(uint32_t series, double time, const std::vector<double> &values) {
+        if (!m_enabled) {
+            return;
+        }
+        m_writer.Append(series, 0, time);
+        for (uint32_t i = 0; i < values.size(); ++i) {
+            m_writer.Append(series, i + 1, values[i]);
+        }
+        m_writer.EndRow(series);
+    }
+
+    // Goodput (Mbps) of every flow since the previous call, from cumulative per-flow `bytes`
+    // counters (e.g. FlowSink::GetFlows()); flows that received nothing yet are skipped
+    template <typename Counters>
+    void RecordFlowThroughput(double time, const std::vector<Counters> &flows) {
+        if (!m_enabled) {
+            return;
+        }
+        double interval = time - m_flowSampleTime;
+        m_flowSampleTime = time;
+        if (m_flowBytes.size() < flows.size()) {
+            m_flowBytes.resize(flows.size(), 0);
+        }
+        for (uint32_t flow = 0; flow < flows.size(); ++flow) {
+            uint64_t bytes = flows[flow].bytes;
+            if (bytes == 0) {
+                continue;
+            }
+            double mbps = interval > 0 ? (bytes - m_flowBytes[flow]) * 8.0 / interval / 1e6 : 0.0;
+            m_flowBytes[flow] = bytes;
+            RecordRow(m_flowSeries, time, {static_cast<double>(flow), mbps});
+        }
+    }
+
+    void Close() {
+        m_writer.Close();
+    }
+
+private:
+    ReplicationRunner &m_replication;
+    ColumnarWriter m_writer;
+    bool m_enabled = false;
+    uint32_t m_flowSeries = 0;
+    double m_flowSampleTime = 0.0;
+    std::vector<uint64_t> m_flowBytes; // per flow at the previous RecordFlowThroughput()
+};
+
+#endif // METRIC_STORE_H
@@ -0,0 +1,190 @@
+/*
+===================================================================
+    Node Roles
+===================================================================
+
+    InternetStackHelper gives every node a full host stack: IPv4 and
+    IPv6 with ARP/NDP and ICMP, UDP, TCP and a packet socket factory,
+    and the QUIC programs add QuicL4Protocol to all of them. A router
+    only forwards and never opens a socket, so most of that is unused,
+    and in large Ring/Mesh/Star topologies most nodes are routers.
+
+    NodeRoles builds the stack by role:
+
+      endpoint  InternetStackHelper, as before
+      router    Ipv4L3Protocol, ARP, ICMPv4 and the traffic-control
+                layer, with the helper's routing (static plus global
+                in an Ipv4ListRouting); no IPv6, UDP, TCP or QUIC
+
+    Routers keep everything forwarding and the monitors use: global
+    routing and ECMP, queue discs, IPv4 traces and interfaces.
+
+    The heap growth while a node's stack is built is charged to that
+    node (glibc mallinfo), as is every per-node step run through
+    InstallEndpoints(), e.g. QuicHelper::InstallQuic. WriteReport()
+    lists every node and then the totals per role and the peak RSS:
+
+      # node role devices objects stackBytes
+
+    objects counts the objects aggregated to the node (protocols,
+    factories). Sockets and packets created during the run are not
+    included.
+
+    Usage:
+    ------------------------
+    g_nodeRoles.Install(nodes, NodeContainer(client, server));
+    g_nodeRoles.InstallEndpoints([&quic](NodeContainer node) { quic.InstallQuic(node); });
+    g_sockets.Install(g_nodeRoles.GetEndpoints());
+    g_nodeRoles.WriteReport(outputDir + "<prefix>.nodemem");
+
+===================================================================
+*/
+
+#ifndef NODE_ROLES_H
+#define NODE_ROLES_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+class NodeRoles {
+public:
+    enum Role { ENDPOINT, ROUTER };
+
+    // Full stack on `endpoints`, IPv4 forwarding only on the other nodes of `nodes`
+    void Install(const ns3::NodeContainer &nodes, const ns3::NodeContainer &endpoints) {
+        std::vector<bool> endpoint;
+        for (uint32_t i = 0; i < endpoints.GetN(); ++i) {
+            uint32_t id = endpoints.Get(i)->GetId();
+            if (id >= endpoint.size()) {
+                endpoint.resize(id + 1, false);
+            }
+            endpoint[id] = true;
+        }
+        ns3::InternetStackHelper stack;
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            ns3::Ptr<ns3::Node> node = nodes.Get(i);
+            uint32_t id = node->GetId();
+            bool isEndpoint = id < endpoint.size() && endpoint[id];
+            uint64_t before = HeapInUse();
+            if (isEndpoint) {
+                stack.Install(node);
+                m_endpoints.Add(node);
+            } else {
+                InstallRouter(node);
+            }
+            Entry &entry = GetEntry(id);
+            entry.node = node;
+            entry.role = isEndpoint ? ENDPOINT : ROUTER;
+            entry.stackBytes += HeapInUse() - before;
+        }
+    }
+
+    // Run `install` (callable taking a NodeContainer) once per endpoint
+    template <typename F>
+    void InstallEndpoints(F install) {
+        for (uint32_t i = 0; i < m_endpoints.GetN(); ++i) {
+            ns3::Ptr<ns3::Node> node = m_endpoints.Get(i);
+            uint64_t before = HeapInUse();
+            install(ns3::NodeContainer(node));
+            GetEntry(node->GetId()).stackBytes += HeapInUse() - before;
+        }
+    }
+
+    const ns3::NodeContainer &GetEndpoints() const {
+        return m_endpoints;
+    }
+
+    void WriteReport(const std::string &path) const {
+        std::ofstream report(path);
+        report << "# node\trole\tdevices\tobjects\tstackBytes" << std::endl;
+        uint64_t count[2] = {0, 0};
+        uint64_t bytes[2] = {0, 0};
+        for (uint32_t id = 0; id < m_entries.size(); ++id) {
+            const Entry &entry = m_entries[id];
+            if (!entry.node) {
+                continue;
+            }
+            uint32_t objects = 0;
+            ns3::Object::AggregateIterator it = entry.node->GetAggregateIterator();
+            while (it.HasNext()) {
+                it.Next();
+                objects++;
+            }
+            report << id << "\t" << RoleName(entry.role) << "\t" << entry.node->GetNDevices() << "\t" << objects
+                   << "\t" << entry.stackBytes << "\n";
+            count[entry.role]++;
+            bytes[entry.role] += entry.stackBytes;
+        }
+        for (int role = ENDPOINT; role <= ROUTER; ++role) {
+            report << "# " << RoleName(static_cast<Role>(role)) << "s " << count[role] << ", stackBytes "
+                   << bytes[role] << ", mean " << (count[role] > 0 ? bytes[role] / count[role] : 0) << "\n";
+        }
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        report << "# peak RSS " << usage.ru_maxrss << " kB" << std::endl;
+    }
+
+private:
+    struct Entry {
+        ns3::Ptr<ns3::Node> node;
+        Role role = ENDPOINT;
+        uint64_t stackBytes = 0;
+    };
+
+    static const char *RoleName(Role role) {
+        return role == ENDPOINT ? "endpoint" : "router";
+    }
+
+    // Heap bytes in use; 0 where glibc's allocator statistics are not available
+    static uint64_t HeapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 info = mallinfo2();
+        return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+        struct mallinfo info = mallinfo();
+        return static_cast<uint32_t>(info.uordblks) + static_cast<uint32_t>(info.hblkhd);
+#else
+        return 0;
+#endif
+    }
+
+    // The IPv4 part of InternetStackHelper::Install, with the same routing
+    static void InstallRouter(ns3::Ptr<ns3::Node> node) {
+        ns3::Ptr<ns3::ArpL3Protocol> arp = ns3::CreateObject<ns3::ArpL3Protocol>();
+        node->AggregateObject(arp);
+        ns3::Ptr<ns3::Ipv4L3Protocol> ipv4 = ns3::CreateObject<ns3::Ipv4L3Protocol>();
+        node->AggregateObject(ipv4);
+        node->AggregateObject(ns3::CreateObject<ns3::Icmpv4L4Protocol>());
+        ns3::Ipv4StaticRoutingHelper staticRouting;
+        ns3::Ipv4GlobalRoutingHelper globalRouting;
+        ns3::Ipv4ListRoutingHelper listRouting;
+        listRouting.Add(staticRouting, 0);
+        listRouting.Add(globalRouting, -10);
+        ipv4->SetRoutingProtocol(listRouting.Create(node));
+        ns3::Ptr<ns3::TrafficControlLayer> tc = ns3::CreateObject<ns3::TrafficControlLayer>();
+        node->AggregateObject(tc);
+        arp->SetTrafficControl(tc);
+    }
+
+    Entry &GetEntry(uint32_t id) {
+        if (id >= m_entries.size()) {
+            m_entries.resize(id + 1);
+        }
+        return m_entries[id];
+    }
+
+    ns3::NodeContainer m_endpoints;
+    std::vector<Entry> m_entries;
+};
+
+#endif // NODE_ROLES_H
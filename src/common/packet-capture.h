@@ -0,0 +1,303 @@
+/*
+===================================================================
+    Streaming Packet Capture
+===================================================================
+
+    Replacement for EnablePcapAll/EnableAsciiAll that writes one
+    pcapng stream for all selected devices instead of one
+    uncompressed file per device.
+
+    The simulator thread only copies the first `snapLen` bytes of a
+    packet into a pending buffer as a ready pcapng Enhanced Packet
+    Block. A background writer thread swaps that buffer out and
+    writes it, through `gzip -1` when compression is on (Wireshark and
+    tcpdump read .pcapng.gz directly). When the writer falls more than
+    MAX_PENDING bytes behind, packets are counted as dropped instead of
+    blocking the simulation; the count is printed by Close().
+
+    Options (see Configure):
+    ------------------------
+      devices   "all" or a comma list of <node>/<device> indices as in
+                /NodeList/<node>/DeviceList/<device>, e.g. "1/1,1/2"
+      snapLen   bytes kept per packet, 0 = whole packet
+      windows   comma list of <from>-<to> simulation seconds, empty =
+                whole run, e.g. "10-12,50-51"
+
+    Each device is one pcapng interface named node<N>/dev<D>, with
+    nanosecond timestamps; P2P devices use LINKTYPE_PPP and CSMA
+    devices LINKTYPE_ETHERNET, as the ns-3 pcap helpers do.
+
+    The writer thread does not survive fork(), so captures are not
+    combined with snapshot branches.
+
+===================================================================
+*/
+
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+class PacketCapture {
+public:
+    static constexpr std::size_t MAX_PENDING = 256 * 1024 * 1024;
+    static constexpr std::size_t WAKE_BYTES = 1024 * 1024;
+
+    ~PacketCapture() {
+        Close();
+    }
+
+    // Select devices, snap length and time windows; returns false on a malformed spec
+    bool Configure(const std::string &devices, uint32_t snapLen, const std::string &windows) {
+        m_snapLen = snapLen;
+        std::stringstream items(windows);
+        std::string item;
+        while (std::getline(items, item, ',')) {
+            std::size_t dash = item.find('-', 1);
+            if (dash == std::string::npos) {
+                std::cerr << "PacketCapture: bad window '" << item << "', expected <from>-<to>" << std::endl;
+                return false;
+            }
+            m_windows.push_back(std::make_pair(std::atof(item.substr(0, dash).c_str()),
+                                               std::atof(item.substr(dash + 1).c_str())));
+        }
+        if (devices == "all") {
+            for (uint32_t n = 0; n < ns3::NodeList::GetNNodes(); ++n) {
+                ns3::Ptr<ns3::Node> node = ns3::NodeList::GetNode(n);
+                for (uint32_t d = 0; d < node->GetNDevices(); ++d) {
+                    AddDevice(node->GetDevice(d));
+                }
+            }
+            return true;
+        }
+        std::stringstream selection(devices);
+        while (std::getline(selection, item, ',')) {
+            std::size_t slash = item.find('/');
+            uint32_t n = static_cast<uint32_t>(std::atoi(item.c_str()));
+            uint32_t d = slash == std::string::npos ? 0 : static_cast<uint32_t>(std::atoi(item.c_str() + slash + 1));
+            if (slash == std::string::npos || n >= ns3::NodeList::GetNNodes() ||
+                d >= ns3::NodeList::GetNode(n)->GetNDevices()) {
+                std::cerr << "PacketCapture: no device '" << item << "'" << std::endl;
+                return false;
+            }
+            AddDevice(ns3::NodeList::GetNode(n)->GetDevice(d));
+        }
+        return true;
+    }
+
+    // Open `path` (gzip-compressed when `compress`) and start capturing
+    bool Start(const std::string &path, bool compress) {
+        if (m_interfaces.empty()) {
+            std::cerr << "PacketCapture: no capturable devices selected" << std::endl;
+            return false;
+        }
+        m_compressed = compress;
+        m_file = compress ? popen(("gzip -1 -c > '" + path + "'").c_str(), "w") : std::fopen(path.c_str(), "wb");
+        if (m_file == nullptr) {
+            std::cerr << "PacketCapture: cannot open " << path << std::endl;
+            return false;
+        }
+        WriteHeaders();
+        for (uint32_t i = 0; i < m_interfaces.size(); ++i) {
+            m_interfaces[i].device->TraceConnectWithoutContext(
+                "PromiscSniffer", ns3::MakeBoundCallback(&PacketCapture::NotifyPacket, this, i));
+        }
+        m_writer = std::thread(&PacketCapture::WriterLoop, this);
+        return true;
+    }
+
+    // Drain the pending packets, stop the writer and close the stream
+    void Close() {
+        if (!m_writer.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_writer.join();
+        if (m_compressed) {
+            pclose(m_file);
+        } else {
+            std::fclose(m_file);
+        }
+        m_file = nullptr;
+        std::cout << "PacketCapture: " << m_captured << " packets written";
+        if (m_dropped > 0) {
+            std::cout << ", " << m_dropped << " dropped (writer fell behind)";
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    struct Interface {
+        ns3::Ptr<ns3::NetDevice> device;
+        std::string name;
+        uint16_t linkType;
+    };
+
+    void AddDevice(ns3::Ptr<ns3::NetDevice> device) {
+        std::string type = device->GetInstanceTypeId().GetName();
+        uint16_t linkType = type == "ns3::PointToPointNetDevice" ? 9 : (type == "ns3::CsmaNetDevice" ? 1 : 0);
+        if (linkType == 0) {
+            return; // loopback and other devices without a sniffer
+        }
+        std::ostringstream name;
+        name << "node" << device->GetNode()->GetId() << "/dev" << device->GetIfIndex();
+        m_interfaces.push_back(Interface{device, name.str(), linkType});
+    }
+
+    bool InWindow(double now) const {
+        if (m_windows.empty()) {
+            return true;
+        }
+        for (const std::pair<double, double> &window : m_windows) {
+            if (now >= window.first && now <= window.second) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void NotifyPacket(PacketCapture *capture, uint32_t interface, ns3::Ptr<const ns3::Packet> packet) {
+        capture->Capture(interface, packet);
+    }
+
+    void Capture(uint32_t interface, ns3::Ptr<const ns3::Packet> packet) {
+        ns3::Time now = ns3::Simulator::Now();
+        if (!InWindow(now.GetSeconds())) {
+            return;
+        }
+        uint32_t length = packet->GetSize();
+        uint32_t captured = m_snapLen > 0 && m_snapLen < length ? m_snapLen : length;
+        uint32_t padded = (captured + 3) & ~3u;
+        uint32_t total = 32 + padded;
+        uint64_t ns = static_cast<uint64_t>(now.GetNanoSeconds());
+
+        // Enhanced Packet Block, encoded here so the writer only copies bytes
+        m_scratch.assign(total, '\0');
+        char *block = &m_scratch[0];
+        StoreU32(block, 6);
+        StoreU32(block + 4, total);
+        StoreU32(block + 8, interface);
+        StoreU32(block + 12, static_cast<uint32_t>(ns >> 32));
+        StoreU32(block + 16, static_cast<uint32_t>(ns));
+        StoreU32(block + 20, captured);
+        StoreU32(block + 24, length);
+        packet->CopyData(reinterpret_cast<uint8_t *>(block + 28), captured);
+        StoreU32(block + 28 + padded, total);
+
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending.size() + total > MAX_PENDING) {
+                m_dropped++;
+                return;
+            }
+            m_pending.append(m_scratch);
+            wake = m_pending.size() >= WAKE_BYTES;
+        }
+        m_captured++;
+        if (wake) {
+            m_wake.notify_one();
+        }
+    }
+
+    void WriterLoop() {
+        std::string batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait_for(lock, std::chrono::milliseconds(200),
+                                [this] { return m_stopping || m_pending.size() >= WAKE_BYTES; });
+                batch.swap(m_pending);
+                if (batch.empty() && m_stopping) {
+                    return;
+                }
+            }
+            std::fwrite(batch.data(), 1, batch.size(), m_file);
+            batch.clear();
+        }
+    }
+
+    // Section Header Block and one Interface Description Block per device
+    void WriteHeaders() {
+        std::string header(28, '\0');
+        StoreU32(&header[0], 0x0A0D0D0A);
+        StoreU32(&header[4], 28);
+        StoreU32(&header[8], 0x1A2B3C4D);
+        StoreU32(&header[12], 1);          // version 1.0
+        StoreU32(&header[16], 0xFFFFFFFF); // section length unknown
+        StoreU32(&header[20], 0xFFFFFFFF);
+        StoreU32(&header[24], 28);
+        for (const Interface &interface : m_interfaces) {
+            uint32_t namePadded = static_cast<uint32_t>((interface.name.size() + 3) & ~static_cast<std::size_t>(3));
+            uint32_t total = 16 + (4 + namePadded) + 8 + 4 + 4;
+            std::string block(total, '\0');
+            char *p = &block[0];
+            StoreU32(p, 1);
+            StoreU32(p + 4, total);
+            p[8] = static_cast<char>(interface.linkType);
+            p[9] = static_cast<char>(interface.linkType >> 8);
+            StoreU32(p + 12, m_snapLen);
+            p += 16;
+            StoreOption(p, 2, interface.name.data(), static_cast<uint16_t>(interface.name.size())); // if_name
+            p += 4 + namePadded;
+            char resolution = 9;                                            // nanoseconds
+            StoreOption(p, 9, &resolution, 1);                              // if_tsresol
+            p += 8;
+            StoreOption(p, 0, nullptr, 0);                                  // opt_endofopt
+            StoreU32(&block[total - 4], total);
+            header += block;
+        }
+        std::fwrite(header.data(), 1, header.size(), m_file);
+    }
+
+    static void StoreOption(char *p, uint16_t code, const char *value, uint16_t length) {
+        p[0] = static_cast<char>(code);
+        p[1] = static_cast<char>(code >> 8);
+        p[2] = static_cast<char>(length);
+        p[3] = static_cast<char>(length >> 8);
+        for (uint16_t i = 0; i < length; ++i) {
+            p[4 + i] = value[i];
+        }
+    }
+
+    static void StoreU32(char *p, uint32_t value) {
+        for (int b = 0; b < 4; ++b) {
+            p[b] = static_cast<char>(value >> (8 * b));
+        }
+    }
+
+    std::vector<Interface> m_interfaces;
+    std::vector<std::pair<double, double>> m_windows;
+    uint32_t m_snapLen = 0;
+    bool m_compressed = true;
+    std::FILE *m_file = nullptr;
+    std::string m_scratch;
+    uint64_t m_captured = 0;
+    uint64_t m_dropped = 0;
+
+    // Shared with the writer thread
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::string m_pending;
+    bool m_stopping = false;
+    std::thread m_writer;
+};
+
+#endif // PACKET_CAPTURE_H
@@ -0,0 +1,308 @@
+/*
+===================================================================
+    Multi-Seed Replication
+===================================================================
+
+    Runs R independent replications of a scenario from one driver
+    process and aggregates the sampled metrics into a mean and a 95%
+    confidence interval per time bin.
+
+    ns-3 cannot re-run a topology after Simulator::Destroy(), and the
+    RNG run number is bound to every random variable when it is
+    created, so each replication is a fork() taken right after
+    argument parsing, before any node exists. Replication i uses
+    RngRun = <base run> + i, where the base run is the usual --RngRun.
+
+    Children discard their per-run text files and stream their samples
+    to the parent over a pipe; the parent writes one
+    <prefix>.<metric>.ci file per metric with the columns
+        time  mean  ci95HalfWidth  replications
+
+===================================================================
+*/
+
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+
+// Metrics shared by all scenario programs; the names match the output file suffixes
+enum ReplicatedMetric : uint32_t {
+    METRIC_CWND = 0,
+    METRIC_RTT,
+    METRIC_THROUGHPUT,
+    METRIC_PACKETLOSS,
+    METRIC_COUNT
+};
+
+inline const char *ReplicatedMetricName(uint32_t metric) {
+    static const char *names[METRIC_COUNT] = {"cwnd", "rtt", "throughput", "packetloss"};
+    return metric < METRIC_COUNT ? names[metric] : "unknown";
+}
+
+class ReplicationRunner {
+public:
+    ~ReplicationRunner() {
+        Finish();
+    }
+
+    // Forks `replications` children, at most `maxParallel` at a time. Returns the replication index
+    // inside a child; in the parent it waits for all children, aggregates their samples and returns -1.
+    int Fork(uint32_t replications, double binWidth, uint32_t maxParallel = 0) {
+        m_binWidth = binWidth;
+        uint32_t baseRun = ns3::RngSeedManager::GetRun();
+        if (maxParallel == 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            maxParallel = cpus > 0 ? static_cast<uint32_t>(cpus) : 1;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+
+        std::vector<Child> active;
+        uint32_t next = 0;
+        while (next < replications || !active.empty()) {
+            while (next < replications && active.size() < maxParallel) {
+                int fds[2];
+                if (pipe(fds) != 0) {
+                    std::cerr << "Replication: pipe() failed: " << std::strerror(errno) << std::endl;
+                    exit(1);
+                }
+                pid_t pid = fork();
+                if (pid < 0) {
+                    std::cerr << "Replication: fork() failed: " << std::strerror(errno) << std::endl;
+                    exit(1);
+                }
+                if (pid == 0) {
+                    close(fds[0]);
+                    for (const Child &other : active) {
+                        close(other.fd);
+                    }
+                    m_fd = fds[1];
+                    m_index = next;
+                    ns3::RngSeedManager::SetRun(baseRun + next);
+                    return static_cast<int>(next);
+                }
+                close(fds[1]);
+                active.push_back(Child{pid, fds[0], next, std::string(), {}});
+                ++next;
+            }
+            Drain(active);
+        }
+
+        std::cout << "Replication: aggregated " << replications << " runs starting at RngRun " << baseRun
+                  << std::endl;
+        return -1;
+    }
+
+    bool IsReplica() const {
+        return m_index >= 0;
+    }
+
+    // Other forking drivers (e.g. the scheduler benchmark) discard their children's outputs the same way
+    void DiscardOutputs() {
+        m_index = std::max(m_index, 0);
+    }
+
+    // Per-run text outputs are discarded inside a replication child
+    std::string OutputPath(const std::string &path) const {
+        return IsReplica() ? "/dev/null" : path;
+    }
+
+    // Forward one sample to the parent; no-op outside a replication child
+    void Record(uint32_t metric, double time, double value) {
+        if (m_fd < 0) {
+            return;
+        }
+        Sample sample = {metric, 0, time, value};
+        m_buffer.append(reinterpret_cast<const char *>(&sample), sizeof(sample));
+        if (m_buffer.size() >= 4096) {
+            Flush();
+        }
+    }
+
+    // Flush pending samples and close the pipe; call at the end of main in every process
+    void Finish() {
+        if (m_fd < 0) {
+            return;
+        }
+        Flush();
+        close(m_fd);
+        m_fd = -1;
+    }
+
+    // Parent only: write <prefix>.<metric>.ci for every metric that received samples
+    void WriteConfidenceIntervals(const std::string &prefix) const {
+        for (uint32_t metric = 0; metric < METRIC_COUNT; ++metric) {
+            bool any = false;
+            for (const auto &entry : m_bins) {
+                if (entry.first.first == metric) {
+                    any = true;
+                    break;
+                }
+            }
+            if (!any) {
+                continue;
+            }
+            std::ofstream file(prefix + "." + ReplicatedMetricName(metric) + ".ci");
+            for (const auto &entry : m_bins) {
+                if (entry.first.first != metric) {
+                    continue;
+                }
+                const Welford &stats = entry.second;
+                double halfWidth = 0.0;
+                if (stats.n > 1) {
+                    double stddev = std::sqrt(stats.m2 / (stats.n - 1));
+                    halfWidth = StudentT975(stats.n - 1) * stddev / std::sqrt(static_cast<double>(stats.n));
+                }
+                file << entry.first.second * m_binWidth << "\t" << stats.mean << "\t" << halfWidth << "\t"
+                     << stats.n << std::endl;
+            }
+        }
+    }
+
+private:
+    struct Sample {
+        uint32_t metric;
+        uint32_t reserved;
+        double time;
+        double value;
+    };
+
+    struct BinSum {
+        double sum = 0.0;
+        uint64_t count = 0;
+    };
+
+    struct Welford {
+        uint64_t n = 0;
+        double mean = 0.0;
+        double m2 = 0.0;
+    };
+
+    typedef std::pair<uint32_t, int64_t> BinKey; // (metric, time bin)
+
+    struct Child {
+        pid_t pid;
+        int fd;
+        uint32_t index;
+        std::string pending;                // partial record carried over between reads
+        std::map<BinKey, BinSum> bins;      // this replication's per-bin sums
+    };
+
+    void Flush() {
+        size_t offset = 0;
+        while (offset < m_buffer.size()) {
+            ssize_t n = write(m_fd, m_buffer.data() + offset, m_buffer.size() - offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            offset += static_cast<size_t>(n);
+        }
+        m_buffer.clear();
+    }
+
+    // Read what the running children have written so far and reap the ones that have finished
+    void Drain(std::vector<Child> &active) {
+        std::vector<pollfd> fds(active.size());
+        for (size_t i = 0; i < active.size(); ++i) {
+            fds[i].fd = active[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            return;
+        }
+        char chunk[65536];
+        for (size_t i = fds.size(); i-- > 0;) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            Child &child = active[i];
+            ssize_t n = read(child.fd, chunk, sizeof(chunk));
+            if (n > 0) {
+                child.pending.append(chunk, static_cast<size_t>(n));
+                size_t whole = child.pending.size() - child.pending.size() % sizeof(Sample);
+                for (size_t offset = 0; offset < whole; offset += sizeof(Sample)) {
+                    Sample sample;
+                    std::memcpy(&sample, child.pending.data() + offset, sizeof(sample));
+                    int64_t bin = static_cast<int64_t>(std::floor(sample.time / m_binWidth + 1e-9));
+                    BinSum &sum = child.bins[BinKey(sample.metric, bin)];
+                    sum.sum += sample.value;
+                    sum.count++;
+                }
+                child.pending.erase(0, whole);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            // EOF: the child has finished
+            close(child.fd);
+            int status = 0;
+            waitpid(child.pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "Replication " << child.index << " exited abnormally (status " << status << ")"
+                          << std::endl;
+            }
+            for (const auto &entry : child.bins) {
+                double value = entry.second.sum / entry.second.count;
+                Welford &stats = m_bins[entry.first];
+                stats.n++;
+                double delta = value - stats.mean;
+                stats.mean += delta / stats.n;
+                stats.m2 += delta * (value - stats.mean);
+            }
+            active.erase(active.begin() + i);
+        }
+    }
+
+    // Two-sided 95% quantile of Student's t distribution; past 30 dof the value of the next
+    // tabulated dof below, so the interval is never narrower than the exact one
+    static double StudentT975(uint64_t dof) {
+        static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                         2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                         2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        if (dof == 0) {
+            return 0.0;
+        }
+        if (dof <= 30) {
+            return table[dof - 1];
+        }
+        if (dof < 40) {
+            return 2.042;
+        }
+        if (dof < 60) {
+            return 2.021;
+        }
+        if (dof < 120) {
+            return 2.000;
+        }
+        return 1.980;
+    }
+
+    int m_fd = -1;
+    int m_index = -1;
+    double m_binWidth = 1.0;
+    std::string m_buffer;
+    std::map<BinKey, Welford> m_bins;
+};
+
+#endif // REPLICATION_H
@@ -0,0 +1,278 @@
+/*
+===================================================================
+    Global Route Cache
+===================================================================
+
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables() builds the link
+    state database and runs one SPF per node on every start, although
+    a parameter sweep builds the same topology hundreds of times. With
+    --routeCache=<dir>, Populate(key) stores the computed routes of
+    every node in <dir>/<key>.routes and later runs load them into
+    the same Ipv4GlobalRouting instances instead of recomputing:
+
+      # routecache v1 <key>
+      I node interface address mask neighbors
+      R node destination mask gateway interface
+
+    The I lines describe the topology the routes belong to: every
+    IPv4 interface with its address and the nodes on the other end of
+    its channel. A cache file is only used when they match the nodes
+    just built, so a changed topology (or a stale file under the same
+    key) is recomputed and the file rewritten. The key only has to
+    name the topology, e.g. "tcpcubic-Mesh-10".
+
+    Nodes, devices and addresses are ns-3 objects and are still built
+    by the program; only the route computation is skipped. Routes are
+    added back in their original order through AddHostRouteTo and
+    AddNetworkRouteTo, so lookups pick the same entries.
+    RecomputeRoutingTables (link events) works as before, since it
+    rebuilds the database from scratch.
+
+    Every call prints the outcome and the time spent, e.g.
+      RouteCache: hit <dir>/tcpcubic-Mesh-10.routes, 90 routes, 0.4 ms
+
+===================================================================
+*/
+
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+class RouteCache {
+public:
+    // Cache directory; empty disables the cache
+    void Configure(const std::string &directory) {
+        m_directory = directory;
+        if (!m_directory.empty() && m_directory.back() != '/') {
+            m_directory += '/';
+        }
+    }
+
+    bool IsEnabled() const {
+        return !m_directory.empty();
+    }
+
+    // Global routes for all nodes: from the cache file of `key` when its topology matches, else computed
+    void Populate(const std::string &key) {
+        if (!IsEnabled()) {
+            ns3::Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+            return;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::string path = m_directory + key + ".routes";
+        std::vector<std::string> topology = DescribeTopology();
+        uint32_t routes = Load(path, topology);
+        const char *outcome = "hit";
+        if (routes == UINT32_MAX) {
+            ns3::Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+            routes = Save(path, key, topology);
+            outcome = "miss";
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "RouteCache: " << outcome << " " << path << ", " << routes << " routes, " << ms << " ms"
+                  << std::endl;
+    }
+
+private:
+    struct Route {
+        uint32_t node = 0;
+        std::string destination;
+        std::string mask;
+        std::string gateway;
+        uint32_t interface = 0;
+    };
+
+    // The global routing protocol of `node`, null if it has none
+    static ns3::Ptr<ns3::Ipv4GlobalRouting> GetGlobalRouting(ns3::Ptr<ns3::Node> node) {
+        ns3::Ptr<ns3::Ipv4> ipv4 = node->GetObject<ns3::Ipv4>();
+        if (!ipv4) {
+            return nullptr;
+        }
+        ns3::Ptr<ns3::Ipv4ListRouting> list = ns3::DynamicCast<ns3::Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        if (!list) {
+            return ns3::DynamicCast<ns3::Ipv4GlobalRouting>(ipv4->GetRoutingProtocol());
+        }
+        for (uint32_t i = 0; i < list->GetNRoutingProtocols(); ++i) {
+            int16_t priority;
+            ns3::Ptr<ns3::Ipv4GlobalRouting> global =
+                ns3::DynamicCast<ns3::Ipv4GlobalRouting>(list->GetRoutingProtocol(i, priority));
+            if (global) {
+                return global;
+            }
+        }
+        return nullptr;
+    }
+
+    // One "I" line per IPv4 interface address of every node
+    static std::vector<std::string> DescribeTopology() {
+        std::vector<std::string> lines;
+        for (uint32_t n = 0; n < ns3::NodeList::GetNNodes(); ++n) {
+            ns3::Ptr<ns3::Node> node = ns3::NodeList::GetNode(n);
+            ns3::Ptr<ns3::Ipv4> ipv4 = node->GetObject<ns3::Ipv4>();
+            if (!ipv4) {
+                continue;
+            }
+            for (uint32_t i = 0; i < ipv4->GetNInterfaces(); ++i) {
+                std::string neighbors = Neighbors(node, ipv4->GetNetDevice(i));
+                for (uint32_t a = 0; a < ipv4->GetNAddresses(i); ++a) {
+                    std::ostringstream line;
+                    ns3::Ipv4InterfaceAddress address = ipv4->GetAddress(i, a);
+                    line << "I\t" << node->GetId() << "\t" << i << "\t" << address.GetLocal() << "\t"
+                         << address.GetMask() << "\t" << neighbors;
+                    lines.push_back(line.str());
+                }
+            }
+        }
+        return lines;
+    }
+
+    // Ids of the other nodes on the channel of `device`, comma separated ("-" for none)
+    static std::string Neighbors(ns3::Ptr<ns3::Node> node, ns3::Ptr<ns3::NetDevice> device) {
+        std::string neighbors;
+        ns3::Ptr<ns3::Channel> channel = device->GetChannel();
+        if (channel) {
+            for (std::size_t d = 0; d < channel->GetNDevices(); ++d) {
+                uint32_t id = channel->GetDevice(d)->GetNode()->GetId();
+                if (id != node->GetId()) {
+                    neighbors += (neighbors.empty() ? "" : ",") + std::to_string(id);
+                }
+            }
+        }
+        return neighbors.empty() ? "-" : neighbors;
+    }
+
+    // Routes added from `path`, or UINT32_MAX if it is missing or describes another topology
+    static uint32_t Load(const std::string &path, const std::vector<std::string> &topology) {
+        std::ifstream in(path);
+        if (!in) {
+            return UINT32_MAX;
+        }
+        std::vector<std::string> routes;
+        std::size_t matched = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            if (line[0] == 'I') {
+                if (matched >= topology.size() || topology[matched] != line) {
+                    return UINT32_MAX;
+                }
+                matched++;
+            } else if (line[0] == 'R') {
+                routes.push_back(line);
+            }
+        }
+        if (matched != topology.size()) {
+            return UINT32_MAX;
+        }
+        // Check every route before adding any, so a bad file never leaves partial tables
+        std::vector<ns3::Ptr<ns3::Ipv4GlobalRouting>> routing(ns3::NodeList::GetNNodes());
+        for (uint32_t n = 0; n < routing.size(); ++n) {
+            routing[n] = GetGlobalRouting(ns3::NodeList::GetNode(n));
+        }
+        std::vector<Route> parsed;
+        for (const std::string &line : routes) {
+            std::istringstream items(line);
+            std::vector<std::string> f;
+            std::string item;
+            while (std::getline(items, item, '\t')) {
+                f.push_back(item);
+            }
+            Route route;
+            if (f.size() != 6 || !ParseIndex(f[1], route.node) || route.node >= routing.size() ||
+                !routing[route.node] || !IsDottedQuad(f[2]) || !IsDottedQuad(f[3]) || !IsDottedQuad(f[4]) ||
+                !ParseIndex(f[5], route.interface) ||
+                route.interface >= ns3::NodeList::GetNode(route.node)->GetObject<ns3::Ipv4>()->GetNInterfaces()) {
+                return UINT32_MAX;
+            }
+            route.destination = f[2];
+            route.mask = f[3];
+            route.gateway = f[4];
+            parsed.push_back(route);
+        }
+        for (const Route &route : parsed) {
+            ns3::Ptr<ns3::Ipv4GlobalRouting> global = routing[route.node];
+            ns3::Ipv4Address destination(route.destination.c_str());
+            ns3::Ipv4Mask mask(route.mask.c_str());
+            ns3::Ipv4Address gateway(route.gateway.c_str());
+            if (mask == ns3::Ipv4Mask::GetOnes()) {
+                global->AddHostRouteTo(destination, gateway, route.interface);
+            } else {
+                global->AddNetworkRouteTo(destination, mask, gateway, route.interface);
+            }
+        }
+        return static_cast<uint32_t>(parsed.size());
+    }
+
+    // A decimal field of a cache line; false for anything else, so a damaged file is recomputed
+    static bool ParseIndex(const std::string &text, uint32_t &value) {
+        char *end = nullptr;
+        errno = 0;
+        unsigned long parsed = std::strtoul(text.c_str(), &end, 10);
+        if (text.empty() || text[0] < '0' || text[0] > '9' || *end != '\0' || errno == ERANGE ||
+            parsed > UINT32_MAX) {
+            return false;
+        }
+        value = static_cast<uint32_t>(parsed);
+        return true;
+    }
+
+    // ns-3 aborts on malformed address strings, so check them before building addresses
+    static bool IsDottedQuad(const std::string &text) {
+        struct in_addr address;
+        return inet_pton(AF_INET, text.c_str(), &address) == 1;
+    }
+
+    // Write the routes of every node; returns their number
+    static uint32_t Save(const std::string &path, const std::string &key, const std::vector<std::string> &topology) {
+        std::string directory = path.substr(0, path.find_last_of('/'));
+        mkdir(directory.c_str(), 0755);
+        // Concurrent replications may write the same key: write a private file, then rename it
+        std::string temporary = path + "." + std::to_string(getpid());
+        std::ofstream out(temporary);
+        out << "# routecache v1 " << key << "\n";
+        for (const std::string &line : topology) {
+            out << line << "\n";
+        }
+        uint32_t count = 0;
+        for (uint32_t n = 0; n < ns3::NodeList::GetNNodes(); ++n) {
+            ns3::Ptr<ns3::Ipv4GlobalRouting> global = GetGlobalRouting(ns3::NodeList::GetNode(n));
+            if (!global) {
+                continue;
+            }
+            for (uint32_t r = 0; r < global->GetNRoutes(); ++r) {
+                ns3::Ipv4RoutingTableEntry *route = global->GetRoute(r);
+                out << "R\t" << n << "\t" << route->GetDest() << "\t" << route->GetDestNetworkMask() << "\t"
+                    << route->GetGateway() << "\t" << route->GetInterface() << "\n";
+                count++;
+            }
+        }
+        out.close();
+        if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::cerr << "RouteCache: could not write " << path << std::endl;
+            std::remove(temporary.c_str());
+        }
+        return count;
+    }
+
+    std::string m_directory;
+};
+
+#endif // ROUTE_CACHE_H
@@ -0,0 +1,199 @@
+/*
+===================================================================
+    Event Scheduler Selection and Benchmark
+===================================================================
+
+    --scheduler picks the ns-3 event queue implementation:
+
+      map            ns3::MapScheduler (ns-3 default, std::map)
+      heap           ns3::HeapScheduler (binary heap)
+      list           ns3::ListScheduler (sorted list)
+      calendar       ns3::CalendarScheduler (calendar queue)
+      priorityqueue  ns3::PriorityQueueScheduler (std::priority_queue)
+
+    --schedulerBenchmark=map,heap,... (or "all") runs the unchanged
+    scenario once per scheduler. Like the replications, each run is a
+    fork() taken before the topology is built, with its output files
+    discarded. The runs are sequential so they do not compete for CPU.
+    Every child times Simulator::Run() (Run below) and reports the
+    executed event count and wall time over a pipe; the parent writes
+    <prefix>.schedulers with
+        scheduler  events  wallSeconds  eventsPerSecond  relative
+        peakRssKb
+    where relative is the speed compared with the fastest scheduler
+    and peakRssKb the child's peak resident set size.
+
+    The event order is the same under every scheduler, so every run
+    executes the same events with the same results.
+
+    ForkEach() is the same machinery for any other choice made before
+    the topology is built, e.g. --senderBenchmark (bulk-sender.h).
+
+===================================================================
+*/
+
+#ifndef SCHEDULER_BENCH_H
+#define SCHEDULER_BENCH_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+#include "replication.h"
+
+class SchedulerBenchmark {
+public:
+    explicit SchedulerBenchmark(ReplicationRunner &replication) : m_replication(replication) {}
+
+    // ns-3 TypeId of a --scheduler name, or "" if unknown
+    static std::string TypeName(const std::string &name) {
+        if (name == "map") {
+            return "ns3::MapScheduler";
+        } else if (name == "heap") {
+            return "ns3::HeapScheduler";
+        } else if (name == "list") {
+            return "ns3::ListScheduler";
+        } else if (name == "calendar") {
+            return "ns3::CalendarScheduler";
+        } else if (name == "priorityqueue") {
+            return "ns3::PriorityQueueScheduler";
+        }
+        return "";
+    }
+
+    // Install the scheduler `name`; call before any event is scheduled
+    static bool Apply(const std::string &name) {
+        std::string type = TypeName(name);
+        if (type.empty()) {
+            std::cerr << "Unknown --scheduler " << name << " (map, heap, list, calendar, priorityqueue)" << std::endl;
+            return false;
+        }
+        ns3::ObjectFactory factory;
+        factory.SetTypeId(type);
+        ns3::Simulator::SetScheduler(factory);
+        return true;
+    }
+
+    // Runs the scenario once per scheduler in `schedulers` ("all" or a comma list). In a child, sets
+    // `scheduler` to its scheduler and returns 0; the parent writes the report to `path` and returns -1.
+    int Fork(const std::string &schedulers, std::string &scheduler, const std::string &path) {
+        std::vector<std::string> names;
+        std::stringstream items(schedulers == "all" ? "map,heap,calendar,priorityqueue,list" : schedulers);
+        std::string item;
+        while (std::getline(items, item, ',')) {
+            if (TypeName(item).empty()) {
+                std::cerr << "Unknown scheduler " << item << " in --schedulerBenchmark" << std::endl;
+                exit(1);
+            }
+            names.push_back(item);
+        }
+        return ForkEach("scheduler", names, scheduler, path);
+    }
+
+    // Runs the scenario once per entry of `names`. In a child, sets `choice` to its entry and returns 0;
+    // the parent writes the report, with `label` as the first column, to `path` and returns -1.
+    int ForkEach(const std::string &label, const std::vector<std::string> &names, std::string &choice,
+                 const std::string &path) {
+        std::cout.flush();
+        std::cerr.flush();
+
+        std::vector<Result> results;
+        for (const std::string &name : names) {
+            int fds[2];
+            if (pipe(fds) != 0) {
+                std::cerr << "SchedulerBenchmark: pipe() failed: " << std::strerror(errno) << std::endl;
+                exit(1);
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "SchedulerBenchmark: fork() failed: " << std::strerror(errno) << std::endl;
+                exit(1);
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                m_fd = fds[1];
+                m_replication.DiscardOutputs();
+                choice = name;
+                return 0;
+            }
+            close(fds[1]);
+            Result result = {0, 0.0, 0};
+            ssize_t n;
+            do {
+                n = read(fds[0], &result, sizeof(result));
+            } while (n < 0 && errno == EINTR);
+            close(fds[0]);
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (n != static_cast<ssize_t>(sizeof(result)) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "SchedulerBenchmark: run with " << name << " failed (status " << status << ")"
+                          << std::endl;
+                result = Result{0, 0.0, 0};
+            }
+            results.push_back(result);
+            std::cout << "SchedulerBenchmark: " << name << " " << result.events << " events in " << result.wallSeconds
+                      << " s" << std::endl;
+        }
+
+        double fastest = 0.0;
+        for (const Result &result : results) {
+            fastest = std::max(fastest, EventsPerSecond(result));
+        }
+        std::ofstream report(path);
+        report << "# " << label << "\tevents\twallSeconds\teventsPerSecond\trelative\tpeakRssKb" << std::endl;
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            double rate = EventsPerSecond(results[i]);
+            report << names[i] << "\t" << results[i].events << "\t" << results[i].wallSeconds << "\t" << rate << "\t"
+                   << (fastest > 0 ? rate / fastest : 0.0) << "\t" << results[i].peakRssKb << std::endl;
+        }
+        return -1;
+    }
+
+    // Simulator::Run(), timed; a benchmark child reports the result to the parent
+    void Run() {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ns3::Simulator::Run();
+        Result result;
+        result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.events = ns3::Simulator::GetEventCount();
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        result.peakRssKb = usage.ru_maxrss;
+        if (m_fd < 0) {
+            return;
+        }
+        ssize_t n;
+        do {
+            n = write(m_fd, &result, sizeof(result));
+        } while (n < 0 && errno == EINTR);
+        close(m_fd);
+        m_fd = -1;
+    }
+
+private:
+    struct Result {
+        uint64_t events;
+        double wallSeconds;
+        int64_t peakRssKb;
+    };
+
+    static double EventsPerSecond(const Result &result) {
+        return result.wallSeconds > 0 ? result.events / result.wallSeconds : 0.0;
+    }
+
+    ReplicationRunner &m_replication;
+    int m_fd = -1;
+};
+
+#endif // SCHEDULER_BENCH_H
@@ -0,0 +1,170 @@
+/*
+===================================================================
+    Warm-Up Snapshots via fork()
+===================================================================
+
+    Simulates the shared warm-up prefix once and branches afterwards.
+    At the snapshot time the running process fork()s one child per
+    branch; every child applies its own attribute perturbation with
+    Config::Set and continues the same event queue from that instant.
+    The parent continues unperturbed as branch 0.
+
+    Branch specification (--snapshotBranches):
+    ------------------------
+    Branches are separated by ';', the assignments of one branch by
+    ',', each assignment is <config path>=<value>, e.g.
+
+      "/NodeList/1/DeviceList/2/$ns3::PointToPointNetDevice/DataRate=2Mbps;
+       /NodeList/1/DeviceList/2/$ns3::PointToPointNetDevice/DataRate=8Mbps"
+
+    Registered output files are re-opened by branch N as
+    <path>.branch<N>, pre-filled with everything written before the
+    snapshot, so every branch file is a complete series.
+
+===================================================================
+*/
+
+#ifndef SNAPSHOT_FORK_H
+#define SNAPSHOT_FORK_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+
+class SnapshotBrancher {
+public:
+    // Output stream that every branch re-opens under its own name
+    void AddOutput(std::ofstream &stream, const std::string &path) {
+        m_outputs.push_back(Output{&stream, path});
+    }
+
+    // Fork one branch per ';'-separated entry of `branches` at simulation time `when`
+    void Schedule(ns3::Time when, const std::string &branches) {
+        std::stringstream specs(branches);
+        std::string spec;
+        while (std::getline(specs, spec, ';')) {
+            spec = Trim(spec);
+            if (!spec.empty()) {
+                m_branches.push_back(spec);
+            }
+        }
+        if (!m_branches.empty()) {
+            ns3::Simulator::Schedule(when, &SnapshotBrancher::Branch, this);
+        }
+    }
+
+    bool IsBranch() const {
+        return m_branch > 0;
+    }
+
+    // Branch-specific name for an output written after the run
+    std::string BranchPath(const std::string &path) const {
+        return m_branch > 0 ? path + ".branch" + std::to_string(m_branch) : path;
+    }
+
+    // Parent only: reap every branch after Simulator::Run() returns
+    void WaitForBranches() {
+        for (pid_t pid : m_children) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "Snapshot branch " << pid << " exited abnormally (status " << status << ")"
+                          << std::endl;
+            }
+        }
+        m_children.clear();
+    }
+
+private:
+    struct Output {
+        std::ofstream *stream;
+        std::string path;
+    };
+
+    void Branch() {
+        std::vector<std::streamoff> prefixSizes;
+        for (const Output &output : m_outputs) {
+            output.stream->flush();
+            prefixSizes.push_back(output.stream->tellp());
+        }
+        std::cout.flush();
+        std::cerr.flush();
+
+        for (uint32_t i = 0; i < m_branches.size(); ++i) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "Snapshot: fork() failed: " << std::strerror(errno) << std::endl;
+                continue;
+            }
+            if (pid == 0) {
+                m_branch = i + 1;
+                m_children.clear();
+                for (uint32_t j = 0; j < m_outputs.size(); ++j) {
+                    ReopenWithPrefix(m_outputs[j], prefixSizes[j]);
+                }
+                Apply(m_branches[i]);
+                std::cout << "Snapshot branch " << m_branch << " continues from t="
+                          << ns3::Simulator::Now().GetSeconds() << " s with " << m_branches[i] << std::endl;
+                return;
+            }
+            m_children.push_back(pid);
+        }
+    }
+
+    void ReopenWithPrefix(const Output &output, std::streamoff prefixSize) {
+        if (output.path == "/dev/null") {
+            return;
+        }
+        output.stream->close();
+        std::string path = BranchPath(output.path);
+        output.stream->open(path);
+        std::ifstream prefix(output.path, std::ios::binary);
+        std::vector<char> buffer(65536);
+        std::streamoff remaining = prefixSize > 0 ? prefixSize : 0;
+        while (remaining > 0 && prefix) {
+            std::streamsize chunk = std::min<std::streamoff>(remaining, buffer.size());
+            prefix.read(buffer.data(), chunk);
+            output.stream->write(buffer.data(), prefix.gcount());
+            remaining -= prefix.gcount();
+        }
+    }
+
+    static void Apply(const std::string &spec) {
+        std::stringstream assignments(spec);
+        std::string assignment;
+        while (std::getline(assignments, assignment, ',')) {
+            assignment = Trim(assignment);
+            size_t eq = assignment.rfind('=');
+            if (eq == std::string::npos) {
+                std::cerr << "Snapshot: ignoring malformed assignment '" << assignment << "'" << std::endl;
+                continue;
+            }
+            ns3::Config::Set(assignment.substr(0, eq), ns3::StringValue(assignment.substr(eq + 1)));
+        }
+    }
+
+    static std::string Trim(const std::string &text) {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) {
+            return "";
+        }
+        size_t last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    std::vector<Output> m_outputs;
+    std::vector<std::string> m_branches;
+    std::vector<pid_t> m_children;
+    uint32_t m_branch = 0;
+};
+
+#endif // SNAPSHOT_FORK_H
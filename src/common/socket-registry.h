@@ -0,0 +1,137 @@
+/*
+===================================================================
+    TCP Socket Registry
+===================================================================
+
+    Hooks per-socket traces (cwnd, RTT, ...) on every TCP socket at
+    the moment it is created, instead of matching a wildcard Config
+    path over the TcpL4Protocol SocketList of every node at a fixed
+    time. Such a path walks the object tree of every node and only
+    finds the sockets that exist at that time; sockets opened later
+    (late-starting senders, accepted connections) are never traced.
+
+    Two entry points cover all sockets:
+
+      senders    Install() aggregates a TrackedTcpSocketFactory to each
+                 node. Applications created with Protocol() as their
+                 socket factory get their socket from TcpL4Protocol as
+                 before, and it is registered before the application
+                 uses it.
+      receivers  Watch() connects to the "Accept" trace of a FlowSink,
+                 which fires for every connection it accepts.
+
+    Each registered socket gets the next flow id (0, 1, ...) and every
+    hook added with AddHook() is called once with (flow, socket). The
+    cost is one call per socket and one aggregation per node, so
+    attaching stays linear in the number of sockets and nodes.
+
+    Usage:
+    ------------------------
+    g_sockets.AddHook(PROFILED(AttachSocketTraces));
+    g_sockets.Install(NodeContainer::GetGlobal());
+    BulkSendHelper source(SocketRegistry::Protocol(), remote);
+    g_sockets.Watch(sink);
+
+===================================================================
+*/
+
+#ifndef SOCKET_REGISTRY_H
+#define SOCKET_REGISTRY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "flow-sink.h"
+
+class SocketRegistry;
+
+// TcpSocketFactory that registers every socket it creates
+class TrackedTcpSocketFactory : public ns3::SocketFactory {
+public:
+    static ns3::TypeId GetTypeId() {
+        static ns3::TypeId tid = ns3::TypeId("ns3::TrackedTcpSocketFactory")
+                                     .SetParent<ns3::SocketFactory>()
+                                     .SetGroupName("Internet")
+                                     .AddConstructor<TrackedTcpSocketFactory>();
+        return tid;
+    }
+
+    void SetRegistry(SocketRegistry *registry) {
+        m_registry = registry;
+    }
+
+    ns3::Ptr<ns3::Socket> CreateSocket() override;
+
+private:
+    SocketRegistry *m_registry = nullptr;
+};
+
+class SocketRegistry {
+public:
+    typedef void (*Hook)(uint32_t flow, ns3::Ptr<ns3::TcpSocketBase> socket);
+
+    // Socket factory name for applications whose sockets are registered
+    static std::string Protocol() {
+        return TrackedTcpSocketFactory::GetTypeId().GetName();
+    }
+
+    // Called for every socket registered from now on
+    void AddHook(Hook hook) {
+        m_hooks.push_back(hook);
+    }
+
+    // Make Protocol() available on `nodes`; they need an internet stack
+    void Install(const ns3::NodeContainer &nodes) {
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            ns3::Ptr<TrackedTcpSocketFactory> factory = ns3::CreateObject<TrackedTcpSocketFactory>();
+            factory->SetRegistry(this);
+            nodes.Get(i)->AggregateObject(factory);
+        }
+    }
+
+    // Register the connections `sink` accepts
+    void Watch(ns3::Ptr<FlowSink> sink) {
+        sink->TraceConnectWithoutContext("Accept", ns3::MakeBoundCallback(&SocketRegistry::NotifyAccept, this));
+    }
+
+    // Flow id of `socket`; non-TCP sockets are ignored (UINT32_MAX)
+    uint32_t Add(ns3::Ptr<ns3::Socket> socket) {
+        ns3::Ptr<ns3::TcpSocketBase> tcp = ns3::DynamicCast<ns3::TcpSocketBase>(socket);
+        if (!tcp) {
+            return UINT32_MAX;
+        }
+        uint32_t flow = static_cast<uint32_t>(m_sockets.size());
+        m_sockets.push_back(tcp);
+        for (Hook hook : m_hooks) {
+            hook(flow, tcp);
+        }
+        return flow;
+    }
+
+    uint32_t GetN() const {
+        return static_cast<uint32_t>(m_sockets.size());
+    }
+
+    ns3::Ptr<ns3::TcpSocketBase> GetSocket(uint32_t flow) const {
+        return m_sockets[flow];
+    }
+
+private:
+    static void NotifyAccept(SocketRegistry *registry, uint32_t, ns3::Ptr<ns3::Socket> socket) {
+        registry->Add(socket);
+    }
+
+    std::vector<Hook> m_hooks;
+    std::vector<ns3::Ptr<ns3::TcpSocketBase>> m_sockets;
+};
+
+inline ns3::Ptr<ns3::Socket> TrackedTcpSocketFactory::CreateSocket() {
+    ns3::Ptr<ns3::Socket> socket = GetObject<ns3::TcpL4Protocol>()->CreateSocket();
+    m_registry->Add(socket);
+    return socket;
+}
+
+#endif // SOCKET_REGISTRY_H
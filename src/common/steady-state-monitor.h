@@ -0,0 +1,160 @@
+/*
+===================================================================
+    Steady-State Monitor
+===================================================================
+
+    Optional convergence check for the sampled throughput and RTT
+    series. Every sample is pushed into a sliding window; once the
+    coefficient of variation (stddev / mean) of BOTH series over the
+    window drops below the requested tolerance, the simulator is
+    stopped and the stopping time is recorded.
+
+    Usage (inside a scenario program):
+    ------------------------
+    g_steadyState.Enable(window, tolerance, minTime);
+    ...
+    g_steadyState.AddSample(throughputMbps, rttMs); // from the sampler
+    ...
+    g_steadyState.WriteReport(outputDir + "quicbbr.steadystate");
+
+===================================================================
+*/
+
+#ifndef STEADY_STATE_MONITOR_H
+#define STEADY_STATE_MONITOR_H
+
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include "ns3/core-module.h"
+
+// Sliding time window over (time, value) samples with mean and coefficient of variation
+class WindowedCv {
+public:
+    explicit WindowedCv(double window = 10.0) : m_window(window) {}
+
+    void SetWindow(double window) {
+        m_window = window;
+    }
+
+    void Clear() {
+        m_samples.clear();
+    }
+
+    void Add(double time, double value) {
+        m_samples.push_back(std::make_pair(time, value));
+        while (!m_samples.empty() && m_samples.front().first < time - m_window) {
+            m_samples.pop_front();
+        }
+    }
+
+    // True once the retained samples span the whole window
+    bool IsFull() const {
+        if (m_samples.size() < 2) {
+            return false;
+        }
+        return (m_samples.back().first - m_samples.front().first) >= m_window * 0.999;
+    }
+
+    double Mean() const {
+        if (m_samples.empty()) {
+            return 0.0;
+        }
+        double sum = 0.0;
+        for (const auto &sample : m_samples) {
+            sum += sample.second;
+        }
+        return sum / m_samples.size();
+    }
+
+    // Coefficient of variation; infinite while the mean is zero (e.g. flow not started)
+    double Cv() const {
+        double mean = Mean();
+        if (m_samples.size() < 2 || mean <= 0.0) {
+            return INFINITY;
+        }
+        double sumSq = 0.0;
+        for (const auto &sample : m_samples) {
+            sumSq += (sample.second - mean) * (sample.second - mean);
+        }
+        return std::sqrt(sumSq / (m_samples.size() - 1)) / mean;
+    }
+
+private:
+    double m_window;
+    std::deque<std::pair<double, double>> m_samples;
+};
+
+class SteadyStateMonitor {
+public:
+    // window: seconds of history, tolerance: max CV (e.g. 0.05 = 5%), minTime: earliest stop time
+    void Enable(double window, double tolerance, double minTime) {
+        m_enabled = true;
+        m_tolerance = tolerance;
+        m_minTime = minTime;
+        m_throughput.SetWindow(window);
+        m_rtt.SetWindow(window);
+    }
+
+    bool IsEnabled() const {
+        return m_enabled;
+    }
+
+    bool IsConverged() const {
+        return m_converged;
+    }
+
+    double GetStopTime() const {
+        return m_stopTime;
+    }
+
+    // Feed one throughput (Mbps) and RTT (ms) sample taken at the current simulation time
+    void AddSample(double throughput, double rtt) {
+        if (!m_enabled || m_converged) {
+            return;
+        }
+        double now = ns3::Simulator::Now().GetSeconds();
+        m_throughput.Add(now, throughput);
+        m_rtt.Add(now, rtt);
+
+        if (now < m_minTime || !m_throughput.IsFull() || !m_rtt.IsFull()) {
+            return;
+        }
+        if (m_throughput.Cv() <= m_tolerance && m_rtt.Cv() <= m_tolerance) {
+            m_converged = true;
+            m_stopTime = now;
+            std::cout << "Steady state reached at " << now << " s (throughput CV " << m_throughput.Cv()
+                      << ", RTT CV " << m_rtt.Cv() << "), stopping simulation" << std::endl;
+            ns3::Simulator::Stop();
+        }
+    }
+
+    // Record the stopping time and the steady-state means
+    void WriteReport(const std::string &path) const {
+        if (!m_enabled) {
+            return;
+        }
+        std::ofstream report(path);
+        report << "converged\t" << (m_converged ? 1 : 0) << std::endl;
+        report << "stopTime\t" << (m_converged ? m_stopTime : ns3::Simulator::Now().GetSeconds()) << std::endl;
+        report << "tolerance\t" << m_tolerance << std::endl;
+        report << "throughputMean\t" << m_throughput.Mean() << std::endl;
+        report << "throughputCv\t" << m_throughput.Cv() << std::endl;
+        report << "rttMean\t" << m_rtt.Mean() << std::endl;
+        report << "rttCv\t" << m_rtt.Cv() << std::endl;
+    }
+
+private:
+    bool m_enabled = false;
+    bool m_converged = false;
+    double m_tolerance = 0.05;
+    double m_minTime = 0.0;
+    double m_stopTime = 0.0;
+    WindowedCv m_throughput;
+    WindowedCv m_rtt;
+};
+
+#endif // STEADY_STATE_MONITOR_H
@@ -0,0 +1,177 @@
+/*
+===================================================================
+    Batched cwnd/RTT Traces
+===================================================================
+
+    TCP fires CongestionWindow and RTT on nearly every ACK. Writing a
+    formatted line per call dominates the trace sinks and yields files
+    with millions of near-identical rows. With --traceBatch the sinks
+    only update a per-flow accumulator in memory:
+
+      last, min, max, count     of the values seen in the window
+
+    and one line is written per flow and window:
+
+      time  last  min  max  count  flow
+
+    where time is the last update in the window. The first two
+    columns keep the layout of the unbatched files, so existing plots
+    still work; min/max keep the cwnd sawtooth extremes visible. The
+    last value also goes to the MetricStore, and with the columnar
+    format the whole line goes to the cwndBatch/rttBatch series
+    (flow, last, min, max, count).
+
+    Window lengths (Configure):
+    ------------------------
+      off       one line per trace call (default)
+      rtt       one window per RTT of the flow (its latest sample in the
+                RTT batcher), 100 ms until the first sample
+      <sec>     a fixed window, e.g. 0.1
+
+    The first update of a window schedules its close at the window's
+    end, so a line is written at the RTT or period boundary and idle
+    flows cost nothing; Flush() writes the open windows at the end of
+    the run. Flows are the SocketRegistry flow ids, so the cwnd and
+    RTT lines of one socket carry the same id.
+
+===================================================================
+*/
+
+#ifndef TRACE_BATCHER_H
+#define TRACE_BATCHER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "metric-store.h"
+
+class TraceBatcher {
+public:
+    static constexpr double DEFAULT_RTT = 0.1;
+
+    TraceBatcher(MetricStore &metrics, uint32_t metric) : m_metrics(metrics), m_metric(metric) {}
+
+    // "off", "rtt" or a window in seconds; `rtt` supplies the per-flow RTT (ms) in "rtt" mode.
+    // Declares the columnar series, so call before MetricStore::Open()
+    bool Configure(const std::string &mode, const TraceBatcher *rtt) {
+        if (mode == "off") {
+            m_enabled = false;
+            return true;
+        }
+        if (mode == "rtt") {
+            m_rttSource = rtt;
+        } else {
+            char *end = nullptr;
+            m_window = std::strtod(mode.c_str(), &end);
+            if (end == mode.c_str() || *end != '\0' || m_window <= 0) {
+                std::cerr << "Unknown --traceBatch " << mode << " (off, rtt or a window in seconds)" << std::endl;
+                return false;
+            }
+        }
+        m_enabled = true;
+        m_series = m_metrics.AddSeries(std::string(ReplicatedMetricName(m_metric)) + "Batch",
+                                       {"flow", "last", "min", "max", "count"});
+        return true;
+    }
+
+    bool IsEnabled() const {
+        return m_enabled;
+    }
+
+    void SetOutput(std::ostream &stream) {
+        m_stream = &stream;
+    }
+
+    void Update(uint32_t flow, double time, double value) {
+        if (flow >= m_flows.size()) {
+            m_flows.resize(flow + 1);
+        }
+        Accumulator &acc = m_flows[flow];
+        if (acc.count > 0 && time >= acc.windowStart + Window(flow)) {
+            Emit(flow, acc);
+        }
+        if (acc.count == 0) {
+            acc.windowStart = time;
+            acc.min = value;
+            acc.max = value;
+            ns3::Simulator::Schedule(ns3::Seconds(Window(flow)), &TraceBatcher::Close, this, flow, acc.windows);
+        }
+        acc.min = std::min(acc.min, value);
+        acc.max = std::max(acc.max, value);
+        acc.last = value;
+        acc.lastTime = time;
+        acc.count++;
+    }
+
+    // Latest value of `flow`, 0 before its first update
+    double Last(uint32_t flow) const {
+        return flow < m_flows.size() ? m_flows[flow].last : 0.0;
+    }
+
+    // Write the windows that are still open
+    void Flush() {
+        for (uint32_t flow = 0; flow < m_flows.size(); ++flow) {
+            if (m_flows[flow].count > 0) {
+                Emit(flow, m_flows[flow]);
+            }
+        }
+        if (m_stream != nullptr) {
+            m_stream->flush();
+        }
+    }
+
+private:
+    struct Accumulator {
+        double last = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        double lastTime = 0.0;
+        double windowStart = 0.0;
+        uint32_t count = 0;
+        uint64_t windows = 0; // windows emitted so far; tells Close() whether its window is still open
+    };
+
+    // Scheduled at the end of window `window` of `flow`
+    void Close(uint32_t flow, uint64_t window) {
+        Accumulator &acc = m_flows[flow];
+        if (acc.count > 0 && acc.windows == window) {
+            Emit(flow, acc);
+        }
+    }
+
+    double Window(uint32_t flow) const {
+        if (m_rttSource == nullptr) {
+            return m_window;
+        }
+        double rtt = m_rttSource->Last(flow) / 1000;
+        return rtt > 0 ? rtt : DEFAULT_RTT;
+    }
+
+    void Emit(uint32_t flow, Accumulator &acc) {
+        if (m_stream != nullptr) {
+            *m_stream << acc.lastTime << " " << acc.last << " " << acc.min << " " << acc.max << " " << acc.count << " "
+                      << flow << "\n";
+        }
+        m_metrics.Record(m_metric, acc.lastTime, acc.last);
+        m_metrics.RecordRow(m_series, acc.lastTime, {static_cast<double>(flow), acc.last, acc.min, acc.max,
+                                                     static_cast<double>(acc.count)});
+        acc.count = 0;
+        acc.windows++;
+    }
+
+    MetricStore &m_metrics;
+    uint32_t m_metric;
+    uint32_t m_series = 0;
+    bool m_enabled = false;
+    double m_window = DEFAULT_RTT;
+    const TraceBatcher *m_rttSource = nullptr;
+    std::ostream *m_stream = nullptr;
+    std::vector<Accumulator> m_flows;
+};
+
+#endif // TRACE_BATCHER_H
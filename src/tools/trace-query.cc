@@ -0,0 +1,202 @@
+/*
+===================================================================
+    Trace Query Tool
+===================================================================
+
+    Answers time-window questions on columnar trace files (.ncol,
+    written with --outputFormat=columnar or --linkStatsPeriod) without
+    loading them: the file is memory-mapped, only the blocks whose
+    time range overlaps [--from, --to] are decoded, and only the
+    requested columns of those blocks.
+
+    Build (plain C++, no ns-3 needed):
+        g++ -std=c++17 -O2 -o trace-query src/tools/trace-query.cc
+
+    Usage:
+    ------------------------
+    trace-query <file.ncol> --list
+        run configuration, series, columns, rows, blocks and time range
+
+    trace-query <file.ncol> [--series=throughput] [--column=value]
+                [--from=T1] [--to=T2] [--by=COLUMN]
+                [--percentiles=50,95,99]
+        count, mean, min, max and the percentiles of one column between
+        T1 and T2 seconds, one line per distinct value of --by. --by
+        needs a key column in the series: flow in flowThroughput,
+        bbr, recovery, cwndBatch and rttBatch, link in links, e.g.
+          --series=flowThroughput --by=flow --from=20 --to=60
+          --series=links --column=utilization --by=link
+        The cwnd, rtt, throughput and packetloss series hold one value
+        per sample and have no flow column.
+
+    Output is tab-separated, like the other result files.
+
+===================================================================
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../common/columnar-reader.h"
+
+struct QueryOptions {
+    std::string path;
+    std::string series = "throughput";
+    std::string column = "value";
+    std::string by;
+    double from = -std::numeric_limits<double>::infinity();
+    double to = std::numeric_limits<double>::infinity();
+    std::vector<double> percentiles = {50, 95, 99};
+    bool list = false;
+};
+
+static void PrintUsage() {
+    std::cerr << "Usage: trace-query <file.ncol> [--list] [--series=NAME] [--column=NAME] [--from=T1] [--to=T2]"
+              << " [--by=COLUMN] [--percentiles=50,95,99]" << std::endl;
+}
+
+static bool ParseOptions(int argc, char *argv[], QueryOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            options.path = arg;
+            continue;
+        }
+        std::size_t eq = arg.find('=');
+        std::string key = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "list") {
+            options.list = true;
+        } else if (key == "series") {
+            options.series = value;
+        } else if (key == "column") {
+            options.column = value;
+        } else if (key == "by") {
+            options.by = value;
+        } else if (key == "from") {
+            options.from = std::atof(value.c_str());
+        } else if (key == "to") {
+            options.to = std::atof(value.c_str());
+        } else if (key == "percentiles") {
+            options.percentiles.clear();
+            std::stringstream items(value);
+            std::string item;
+            while (std::getline(items, item, ',')) {
+                options.percentiles.push_back(std::atof(item.c_str()));
+            }
+        } else {
+            std::cerr << "trace-query: unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return !options.path.empty();
+}
+
+static void ListFile(const ColumnarReader &reader) {
+    for (const auto &attribute : reader.GetAttributes()) {
+        std::cout << "# " << attribute.first << "=" << attribute.second << std::endl;
+    }
+    std::cout << "# series\tcolumns\trows\tblocks\tfrom\tto" << std::endl;
+    const std::vector<ColumnarReader::SeriesInfo> &series = reader.GetSeries();
+    for (uint32_t s = 0; s < series.size(); ++s) {
+        uint32_t blocks = 0;
+        double first = std::numeric_limits<double>::infinity();
+        double last = -std::numeric_limits<double>::infinity();
+        for (const ColumnarReader::BlockInfo &block : reader.GetBlocks()) {
+            if (block.series == s) {
+                blocks++;
+                first = std::min(first, block.tMin);
+                last = std::max(last, block.tMax);
+            }
+        }
+        std::string columns;
+        for (const ColumnarReader::ColumnInfo &column : series[s].columns) {
+            columns += (columns.empty() ? "" : ",") + column.name + ":" + ColumnTypeName(column.type);
+        }
+        std::cout << series[s].name << "\t" << columns << "\t" << reader.CountRows(s) << "\t" << blocks << "\t"
+                  << (blocks > 0 ? first : 0.0) << "\t" << (blocks > 0 ? last : 0.0) << std::endl;
+    }
+}
+
+// Nearest-rank percentile of sorted values
+static double Percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+int main(int argc, char *argv[]) {
+    QueryOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    ColumnarReader reader;
+    if (!reader.Open(options.path)) {
+        return 1;
+    }
+    if (options.list) {
+        ListFile(reader);
+        return 0;
+    }
+
+    int32_t series = reader.FindSeries(options.series);
+    int32_t column = reader.FindColumn(series, options.column);
+    int32_t group = options.by.empty() ? -1 : reader.FindColumn(series, options.by);
+    if (series < 0 || column < 0 || (!options.by.empty() && group < 0)) {
+        std::cerr << "trace-query: no column " << options.series << "/"
+                  << (column < 0 ? options.column : options.by) << " (see --list)" << std::endl;
+        return 1;
+    }
+
+    // Only the values inside the window are kept, per group, for the percentiles
+    std::map<double, std::vector<double>> groups;
+    std::vector<int32_t> columns = {column};
+    if (group >= 0) {
+        columns.push_back(group);
+    }
+    reader.Scan(series, columns, options.from, options.to,
+                [&groups, group](const std::vector<std::vector<double>> &values, std::size_t row) {
+                    if (row >= values[0].size() || (group >= 0 && row >= values[1].size())) {
+                        return;
+                    }
+                    groups[group >= 0 ? values[1][row] : 0.0].push_back(values[0][row]);
+                });
+
+    std::cout << "# " << options.series << "/" << options.column << " from " << options.from << " to "
+              << options.to << std::endl;
+    std::cout << "# " << (group >= 0 ? options.by : "all") << "\tcount\tmean\tmin\tmax";
+    for (double p : options.percentiles) {
+        std::cout << "\tp" << p;
+    }
+    std::cout << std::endl;
+    for (auto &entry : groups) {
+        std::vector<double> &values = entry.second;
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (double value : values) {
+            sum += value;
+        }
+        if (group >= 0) {
+            std::cout << entry.first;
+        } else {
+            std::cout << "all";
+        }
+        std::cout << "\t" << values.size() << "\t" << sum / values.size() << "\t" << values.front() << "\t"
+                  << values.back();
+        for (double p : options.percentiles) {
+            std::cout << "\t" << Percentile(values, p);
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}